@@ -14,5 +14,28 @@
 #include "analogVector.h"
 #include "analogContext.h"
 #include "analogOperations.h"
+#include "analogActivation.h"
+#include "analogRecurrent.h"
+#include "analogDigital.h"
+#include "analogLinear.h"
+#include "analogThreadPool.h"
+#include "analogTiled.h"
+#include "analogBalance.h"
+#include "analogKernels.h"
+#include "analogTransformer.h"
+#include "analogRotation.h"
+#include "analogDifferential.h"
+#include "analogSolver.h"
+#include "analogSparse.h"
+#include "analogCache.h"
+#include "analogRefresh.h"
+#include "analogPrefetch.h"
+#include "analogPaging.h"
+#include "analogLazy.h"
+#include "analogMoE.h"
+#include "analogQoS.h"
+#include "analogBatch.h"
+#include "analogDaemon.h"
+#include "analogRing.h"
 
 #endif // ANALOG_H
@@ -0,0 +1,97 @@
+/**
+ * @file analogActivation.h
+ * @brief This file contains lookup-table based activation functions applied during dequantization.
+ */
+
+#ifndef ANALOG_ACTIVATION_H
+#define ANALOG_ACTIVATION_H
+
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * @class AnalogLUT
+ * @brief Piecewise-linear lookup table approximating a scalar function on a bounded range.
+ *
+ * Inputs outside [lo, hi] saturate to the table end points, which is exact enough for
+ * saturating nonlinearities such as sigmoid and tanh.
+ * @tparam T Floating-point type of the inputs and outputs.
+ * @tparam N Number of table entries.
+ */
+template <typename T, uint32_t N = 256>
+class AnalogLUT {
+public:
+    /**
+     * @brief Constructor of the AnalogLUT class.
+     * @param fn The function to tabulate.
+     * @param lo Lower bound of the tabulated range.
+     * @param hi Upper bound of the tabulated range.
+     */
+    AnalogLUT(T (*fn)(T), T lo, T hi)
+        : lo(lo),
+          hi(hi),
+          inv_step(static_cast<T>(N - 1) / (hi - lo)) {
+        static_assert(std::is_floating_point<T>::value, "AnalogLUT requires floating-point data type");
+        static_assert(N >= 2, "AnalogLUT requires at least two entries");
+        T step = (hi - lo) / static_cast<T>(N - 1);
+        for (uint32_t i = 0; i < N; i++) {
+            table[i] = fn(lo + step * static_cast<T>(i));
+        }
+    }
+
+    /**
+     * @brief Evaluates the table at a given point.
+     * @param x The input value.
+     * @return The interpolated function value.
+     */
+    T operator()(T x) const {
+        if (x <= lo) {
+            return table[0];
+        }
+        if (x >= hi) {
+            return table[N - 1];
+        }
+        T pos = (x - lo) * inv_step;
+        uint32_t idx = static_cast<uint32_t>(pos);
+        if (idx >= N - 1) {
+            return table[N - 1];
+        }
+        T frac = pos - static_cast<T>(idx);
+        return table[idx] + frac * (table[idx + 1] - table[idx]);
+    }
+
+private:
+    T lo;          ///< Lower bound of the tabulated range.
+    T hi;          ///< Upper bound of the tabulated range.
+    T inv_step;    ///< Reciprocal of the spacing between table entries.
+    T table[N];    ///< Tabulated function values.
+};
+
+template <typename T>
+T analog_sigmoid(T x) {
+    return static_cast<T>(1) / (static_cast<T>(1) + std::exp(-x));
+}
+
+template <typename T>
+T analog_tanh(T x) {
+    return std::tanh(x);
+}
+
+/**
+ * @brief Builds a sigmoid lookup table saturating outside [-8, 8].
+ */
+template <typename T, uint32_t N = 256>
+AnalogLUT<T, N> make_sigmoid_lut() {
+    return AnalogLUT<T, N>(&analog_sigmoid<T>, static_cast<T>(-8), static_cast<T>(8));
+}
+
+/**
+ * @brief Builds a tanh lookup table saturating outside [-4, 4].
+ */
+template <typename T, uint32_t N = 256>
+AnalogLUT<T, N> make_tanh_lut() {
+    return AnalogLUT<T, N>(&analog_tanh<T>, static_cast<T>(-4), static_cast<T>(4));
+}
+
+#endif // ANALOG_ACTIVATION_H
@@ -0,0 +1,158 @@
+/**
+ * @file analogBalance.h
+ * @brief This file contains an executor that splits a tiled layer between analog tiles and CPU threads.
+ */
+
+#ifndef ANALOG_BALANCE_H
+#define ANALOG_BALANCE_H
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <vector>
+
+#include "analogTiled.h"
+#include "analogThreadPool.h"
+
+/**
+ * @class AnalogLoadBalancer
+ * @brief Runs the leading row blocks of a tiled layer on the tiles and the rest on CPU threads.
+ *
+ * The host thread driving the tiles and the pool threads run concurrently. After every call the
+ * measured time per row block on the tiles and per row block per CPU thread are folded into
+ * exponential moving averages, and the analog share of the next call is set so both sides are
+ * expected to finish together: ratio = rate_analog / (rate_analog + rate_cpu).
+ * @tparam T Host data type.
+ * @tparam qT Device data type of weights and inputs.
+ * @tparam oT Device data type of the outputs.
+ */
+template <typename T, typename qT = T, typename oT = qT>
+class AnalogLoadBalancer {
+public:
+    /**
+     * @brief Constructor of the AnalogLoadBalancer class.
+     * @param layer The tiled layer to execute.
+     * @param pool Thread pool running the CPU row blocks.
+     * @param initial_ratio Share of row blocks initially sent to the tiles, in [0, 1].
+     * @param smoothing Weight of the newest measurement in the moving averages, in (0, 1].
+     */
+    AnalogLoadBalancer(AnalogTiledLinear<T, qT, oT> &layer, AnalogThreadPool &pool,
+                       double initial_ratio = 0.5, double smoothing = 0.25)
+        : layer(layer),
+          pool(pool),
+          analog_ratio(initial_ratio),
+          smoothing(smoothing),
+          analog_block_time(0.0),
+          cpu_block_time(0.0),
+          adaptive(true) {}
+
+    /**
+     * @brief Computes y = W x, dividing the row blocks between tiles and CPU threads.
+     * @param x Input vector (cols).
+     * @param y Output vector (rows).
+     */
+    void forward(T* x, T* y) {
+        typedef std::chrono::steady_clock clock;
+
+        layer.quantize_input(x);
+
+        uint32_t n = layer.get_row_blocks();
+        uint32_t k = analog_blocks(n);
+
+        // CPU share: one contiguous chunk of row blocks per thread.
+        uint32_t cpu_blocks = n - k;
+        uint32_t threads = pool.size() < cpu_blocks ? pool.size() : cpu_blocks;
+        std::vector<double> busy(threads, 0.0);
+        std::vector<std::future<void>> pending;
+        for (uint32_t t = 0; t < threads; t++) {
+            uint32_t lo = k + static_cast<uint32_t>(static_cast<uint64_t>(cpu_blocks) * t / threads);
+            uint32_t hi = k + static_cast<uint32_t>(static_cast<uint64_t>(cpu_blocks) * (t + 1) / threads);
+            double* slot = &busy[t];
+            pending.push_back(pool.submit([this, lo, hi, y, slot] {
+                clock::time_point start = clock::now();
+                layer.forward_rows_digital(lo, hi, y);
+                *slot = std::chrono::duration<double>(clock::now() - start).count();
+            }));
+        }
+
+        clock::time_point start = clock::now();
+        layer.forward_rows_analog(0, k, y);
+        double analog_time = std::chrono::duration<double>(clock::now() - start).count();
+
+        for (auto &p : pending) {
+            p.get();
+        }
+
+        double cpu_time = 0.0;
+        for (double b : busy) {
+            cpu_time += b;
+        }
+        if (k > 0) {
+            analog_block_time = update_average(analog_block_time, analog_time / k);
+        }
+        if (cpu_blocks > 0) {
+            cpu_block_time = update_average(cpu_block_time, cpu_time / cpu_blocks);
+        }
+        if (adaptive && analog_block_time > 0.0 && cpu_block_time > 0.0) {
+            double analog_rate = 1.0 / analog_block_time;
+            double cpu_rate = pool.size() / cpu_block_time;
+            analog_ratio = analog_rate / (analog_rate + cpu_rate);
+        }
+    }
+
+    /**
+     * @brief Fixes the analog share and stops adapting it.
+     * @param ratio Share of row blocks sent to the tiles, in [0, 1].
+     */
+    void set_analog_ratio(double ratio) {
+        analog_ratio = ratio;
+        adaptive = false;
+    }
+
+    /**
+     * @brief Resumes adapting the analog share from measurements.
+     */
+    void set_adaptive(bool enable) {
+        adaptive = enable;
+    }
+
+    double get_analog_ratio() const { return analog_ratio; }
+    double get_analog_block_time() const { return analog_block_time; }
+    double get_cpu_block_time() const { return cpu_block_time; }
+
+private:
+    /**
+     * @brief Number of leading row blocks sent to the tiles for the current ratio.
+     *
+     * While adapting, both sides keep at least one block so neither estimate goes stale.
+     */
+    uint32_t analog_blocks(uint32_t n) const {
+        uint32_t k = static_cast<uint32_t>(std::lround(analog_ratio * n));
+        if (k > n) {
+            k = n;
+        }
+        if (adaptive && n >= 2) {
+            if (k == 0) {
+                k = 1;
+            } else if (k == n) {
+                k = n - 1;
+            }
+        }
+        return k;
+    }
+
+    double update_average(double average, double sample) const {
+        return average == 0.0 ? sample : smoothing * sample + (1.0 - smoothing) * average;
+    }
+
+    AnalogTiledLinear<T, qT, oT> &layer; ///< Layer being executed.
+    AnalogThreadPool &pool;              ///< Threads running the CPU share.
+    double analog_ratio;                 ///< Share of row blocks sent to the tiles.
+    double smoothing;                    ///< Weight of the newest measurement.
+    double analog_block_time;            ///< Average seconds per row block on the tiles.
+    double cpu_block_time;               ///< Average seconds per row block on one CPU thread.
+    bool adaptive;                       ///< Whether the ratio follows the measurements.
+};
+
+#endif // ANALOG_BALANCE_H
@@ -0,0 +1,379 @@
+/**
+ * @file analogBatch.h
+ * @brief This file contains an SLO-aware dynamic batcher that groups incoming vectors per programmed matrix.
+ *
+ * Requests for the same target (a programmed layer) are queued and dispatched together once the
+ * batch is full or the oldest request has waited for the batching window. Targets with a batch
+ * forward (tiled layers) run the whole batch weight-stationary, so block setup is paid once per
+ * batch instead of once per vector; other targets run their vectors one at a time. Either way
+ * the saving is per-dispatch overhead, which only matters near saturation, so the window is
+ * driven by the utilization (arrival rate times per-vector service time): zero below a
+ * utilization threshold, then growing towards the time needed to fill a batch as the target
+ * approaches saturation, and always capped so that waiting plus serving a full batch stays
+ * within the latency SLO.
+ * Ready targets are served round-robin, so a saturated target cannot starve the others.
+ */
+
+#ifndef ANALOG_BATCH_H
+#define ANALOG_BATCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "analogLinear.h"
+#include "analogTiled.h"
+
+/**
+ * @class AnalogDynamicBatcher
+ * @brief Collects vectors per target and dispatches them in adaptive batches on a serving thread.
+ * @tparam T Host data type.
+ */
+template <typename T>
+class AnalogDynamicBatcher {
+public:
+    /**
+     * @brief Constructor of the AnalogDynamicBatcher class.
+     * @param max_batch Largest number of vectors dispatched together.
+     * @param slo Target latency from submit to completion in seconds.
+     * @param smoothing Weight of the newest sample in the rate and cost averages.
+     * @param latency_window Number of most recent latencies kept per target for percentiles.
+     * @param min_utilization Utilization below which vectors are dispatched without waiting.
+     */
+    AnalogDynamicBatcher(uint32_t max_batch, double slo, double smoothing = 0.1, uint32_t latency_window = 4096,
+                         double min_utilization = 0.5)
+        : max_batch(max_batch > 0 ? max_batch : 1),
+          slo(slo),
+          min_utilization(min_utilization < 1.0 ? min_utilization : 0.99),
+          smoothing(smoothing),
+          latency_window(latency_window > 0 ? latency_window : 1),
+          next_target(0),
+          stopping(false) {}
+
+    AnalogDynamicBatcher(const AnalogDynamicBatcher&) = delete;
+    AnalogDynamicBatcher& operator=(const AnalogDynamicBatcher&) = delete;
+
+    ~AnalogDynamicBatcher() {
+        stop();
+    }
+
+    /**
+     * @brief Registers a target computing y = f(x).
+     * @param forward Computes one vector; only called from the serving thread.
+     * @param in_len Length of x.
+     * @param out_len Length of y.
+     * @return The target ID.
+     */
+    uint32_t add_target(std::function<void(T*, T*)> forward, uint32_t in_len, uint32_t out_len) {
+        return add_target(std::move(forward), nullptr, in_len, out_len);
+    }
+
+    /**
+     * @brief Registers a target that can compute a whole batch in one call.
+     * @param forward Computes one vector; only called from the serving thread.
+     * @param forward_batch Computes ys[v] = f(xs[v]) for n vectors; may be empty.
+     * @param in_len Length of x.
+     * @param out_len Length of y.
+     * @return The target ID.
+     */
+    uint32_t add_target(std::function<void(T*, T*)> forward,
+                        std::function<void(T* const*, T* const*, uint32_t)> forward_batch,
+                        uint32_t in_len, uint32_t out_len) {
+        std::lock_guard<std::mutex> lock(mutex);
+        targets.emplace_back(new Target(std::move(forward), std::move(forward_batch), in_len, out_len));
+        return static_cast<uint32_t>(targets.size() - 1);
+    }
+
+    /**
+     * @brief Registers a layer as a target.
+     */
+    template <typename qT, typename oT>
+    uint32_t add_target(AnalogLinear<T, qT, oT> &layer) {
+        return add_target([&layer](T* x, T* y) { layer.forward(x, y); },
+                          layer.get_matrix().get_host_cols(), layer.get_matrix().get_host_rows());
+    }
+
+    /**
+     * @brief Registers a tiled layer as a target; its batches run through forward_batch.
+     */
+    template <typename qT, typename oT>
+    uint32_t add_target(AnalogTiledLinear<T, qT, oT> &layer) {
+        return add_target([&layer](T* x, T* y) { layer.forward(x, y); },
+                          [&layer](T* const* xs, T* const* ys, uint32_t n) { layer.forward_batch(xs, ys, n); },
+                          layer.get_cols(), layer.get_rows());
+    }
+
+    /**
+     * @brief Queues one vector.
+     * @param target The target ID.
+     * @param x Input vector (copied).
+     * @param y Output vector; written before the returned future becomes ready.
+     */
+    std::future<void> submit(uint32_t target, const T* x, T* y) {
+        std::unique_ptr<Request> req(new Request());
+        std::future<void> done = req->done.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (target >= targets.size()) {
+                std::cerr << "Error: unknown batching target " << target << "." << std::endl;
+                req->done.set_value();
+                return done;
+            }
+            Target &t = *targets[target];
+            req->x.assign(x, x + t.in_len);
+            req->y = y;
+            req->submitted = std::chrono::steady_clock::now();
+            if (t.arrivals > 0) {
+                double gap = std::chrono::duration<double>(req->submitted - t.last_arrival).count();
+                t.mean_gap = t.arrivals == 1 ? gap : (1.0 - smoothing) * t.mean_gap + smoothing * gap;
+            }
+            t.arrivals++;
+            t.last_arrival = req->submitted;
+            t.queue.push_back(std::move(req));
+        }
+        cv.notify_one();
+        return done;
+    }
+
+    /**
+     * @brief Starts the serving thread.
+     */
+    void start() {
+        stop();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = false;
+        }
+        worker = std::thread([this] { serve(); });
+    }
+
+    /**
+     * @brief Stops the serving thread after draining the queued vectors.
+     */
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    /**
+     * @brief Returns the current batching window of a target in seconds.
+     */
+    double get_window(uint32_t target) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return window(*targets[target]);
+    }
+
+    /**
+     * @brief Returns the utilization of a target (arrival rate times per-vector service time).
+     */
+    double get_utilization(uint32_t target) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const Target &t = *targets[target];
+        return rate(t) * t.item_cost;
+    }
+
+    /**
+     * @brief Returns the observed arrival rate of a target in vectors per second.
+     */
+    double get_arrival_rate(uint32_t target) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return rate(*targets[target]);
+    }
+
+    uint64_t get_batches(uint32_t target) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return targets[target]->batches;
+    }
+
+    double get_mean_batch_size(uint32_t target) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const Target &t = *targets[target];
+        return t.batches ? static_cast<double>(t.served) / t.batches : 0.0;
+    }
+
+    /**
+     * @brief Returns a percentile (0-100) of the submit-to-completion latency in seconds over the recent window.
+     */
+    double get_latency_percentile(uint32_t target, double percentile) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<double> sorted = targets[target]->latencies;
+        if (sorted.empty()) {
+            return 0.0;
+        }
+        std::sort(sorted.begin(), sorted.end());
+        size_t idx = static_cast<size_t>(percentile / 100.0 * (sorted.size() - 1) + 0.5);
+        return sorted[std::min(idx, sorted.size() - 1)];
+    }
+
+    void reset_counters() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &t : targets) {
+            t->batches = 0;
+            t->served = 0;
+            t->latencies.clear();
+            t->latency_pos = 0;
+        }
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Request {
+        std::vector<T> x;            ///< Copy of the input.
+        T* y;                        ///< Caller's output.
+        Clock::time_point submitted; ///< Submission time.
+        std::promise<void> done;     ///< Ready once y is written.
+    };
+
+    struct Target {
+        Target(std::function<void(T*, T*)> forward, std::function<void(T* const*, T* const*, uint32_t)> forward_batch,
+               uint32_t in_len, uint32_t out_len)
+            : forward(std::move(forward)), forward_batch(std::move(forward_batch)), in_len(in_len), out_len(out_len),
+              arrivals(0), mean_gap(0.0), item_cost(0.0), batches(0), served(0), latency_pos(0) {}
+
+        std::function<void(T*, T*)> forward;          ///< Computes one vector.
+        std::function<void(T* const*, T* const*, uint32_t)> forward_batch; ///< Computes a batch, if set.
+        uint32_t in_len;                              ///< Input length.
+        uint32_t out_len;                             ///< Output length.
+        std::deque<std::unique_ptr<Request>> queue;   ///< Waiting vectors, oldest first.
+        uint64_t arrivals;                            ///< Vectors submitted.
+        Clock::time_point last_arrival;               ///< Time of the last submit.
+        double mean_gap;                              ///< Mean inter-arrival gap (seconds).
+        double item_cost;                             ///< Mean service time of one vector (seconds).
+        uint64_t batches;                             ///< Batches dispatched.
+        uint64_t served;                              ///< Vectors dispatched.
+        std::vector<double> latencies;                ///< Recent latencies (ring).
+        size_t latency_pos;                           ///< Next ring position once full.
+    };
+
+    static double rate(const Target &t) {
+        return t.arrivals > 1 && t.mean_gap > 0.0 ? 1.0 / t.mean_gap : 0.0;
+    }
+
+    /**
+     * @brief Batching window of a target; mutex must be held.
+     */
+    double window(const Target &t) const {
+        double r = rate(t);
+        double utilization = r * t.item_cost;
+        double slack = slo - t.item_cost * max_batch;
+        if (r <= 0.0 || slack <= 0.0 || utilization <= min_utilization) {
+            return 0.0; // The target keeps up without batching; waiting would only add latency
+        }
+        // Scale from no wait at min_utilization to the full fill time at saturation
+        double pressure = std::min(1.0, (utilization - min_utilization) / (1.0 - min_utilization));
+        return std::min(pressure * (max_batch - 1) / r, slack);
+    }
+
+    void serve() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            Clock::time_point now = Clock::now();
+            Clock::time_point wake = Clock::time_point::max();
+            int pick = -1;
+            for (size_t k = 0; k < targets.size(); k++) {
+                // Round-robin from the target after the last one served
+                size_t i = (next_target + k) % targets.size();
+                Target &t = *targets[i];
+                if (t.queue.empty()) {
+                    continue;
+                }
+                Clock::time_point deadline = t.queue.front()->submitted +
+                    std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(window(t)));
+                if (t.queue.size() >= max_batch || deadline <= now || stopping) {
+                    pick = static_cast<int>(i);
+                    break;
+                }
+                wake = std::min(wake, deadline);
+            }
+            if (pick < 0) {
+                if (stopping) {
+                    return;
+                }
+                if (wake == Clock::time_point::max()) {
+                    cv.wait(lock);
+                } else {
+                    cv.wait_until(lock, wake);
+                }
+                continue;
+            }
+
+            Target &t = *targets[pick];
+            next_target = static_cast<size_t>(pick) + 1;
+            std::vector<std::unique_ptr<Request>> batch;
+            while (!t.queue.empty() && batch.size() < max_batch) {
+                batch.push_back(std::move(t.queue.front()));
+                t.queue.pop_front();
+            }
+            lock.unlock();
+
+            std::vector<double> latencies(batch.size());
+            Clock::time_point start = Clock::now();
+            if (t.forward_batch && batch.size() > 1) {
+                std::vector<T*> xs(batch.size());
+                std::vector<T*> ys(batch.size());
+                for (size_t i = 0; i < batch.size(); i++) {
+                    xs[i] = batch[i]->x.data();
+                    ys[i] = batch[i]->y;
+                }
+                t.forward_batch(xs.data(), ys.data(), static_cast<uint32_t>(batch.size()));
+                Clock::time_point end = Clock::now();
+                for (size_t i = 0; i < batch.size(); i++) {
+                    latencies[i] = std::chrono::duration<double>(end - batch[i]->submitted).count();
+                    batch[i]->done.set_value();
+                }
+            } else {
+                for (size_t i = 0; i < batch.size(); i++) {
+                    t.forward(batch[i]->x.data(), batch[i]->y);
+                    Clock::time_point end = Clock::now();
+                    latencies[i] = std::chrono::duration<double>(end - batch[i]->submitted).count();
+                    batch[i]->done.set_value();
+                }
+            }
+            double cost = std::chrono::duration<double>(Clock::now() - start).count() / batch.size();
+
+            lock.lock();
+            t.item_cost = t.batches == 0 ? cost : (1.0 - smoothing) * t.item_cost + smoothing * cost;
+            t.batches++;
+            t.served += batch.size();
+            for (double latency : latencies) {
+                if (t.latencies.size() < latency_window) {
+                    t.latencies.push_back(latency);
+                } else {
+                    t.latencies[t.latency_pos] = latency;
+                    t.latency_pos = (t.latency_pos + 1) % latency_window;
+                }
+            }
+        }
+    }
+
+    uint32_t max_batch;          ///< Largest batch.
+    double slo;                  ///< Target latency (seconds).
+    double min_utilization;      ///< Utilization below which nothing waits.
+    double smoothing;            ///< Weight of the newest sample in the averages.
+    uint32_t latency_window;     ///< Latencies kept per target.
+
+    std::vector<std::unique_ptr<Target>> targets; ///< Registered targets.
+    size_t next_target;                           ///< Target checked first by the next dispatch.
+    std::mutex mutex;                             ///< Guards targets and queues.
+    std::condition_variable cv;                   ///< Wakes the serving thread.
+    std::thread worker;                           ///< Serving thread.
+    bool stopping;                                ///< Whether the serving thread should drain and exit.
+};
+
+#endif // ANALOG_BATCH_H
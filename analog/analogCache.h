@@ -0,0 +1,228 @@
+/**
+ * @file analogCache.h
+ * @brief This file contains a per-tile memoization cache for the outputs of repeated quantized inputs.
+ *
+ * Entries are keyed by a hash of the quantized input codes, the input code offset and the
+ * matrix version of the tile (AnalogContext::get_matrix_version), so reprogramming a tile
+ * invalidates its entries. A hit returns the stored output codes without issuing mvm.l, mvm or
+ * mvm.s; dequantization is unchanged, so cached and computed outputs are bit-identical.
+ */
+
+#ifndef ANALOG_CACHE_H
+#define ANALOG_CACHE_H
+
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "analogVector.h"
+#include "analogContext.h"
+#include "analogOperations.h"
+
+/**
+ * @class AnalogResultCache
+ * @brief LRU cache of tile outputs, bounded to a fixed number of entries per tile.
+ * @tparam qT Device data type of the inputs.
+ * @tparam oT Device data type of the outputs.
+ */
+template <typename qT, typename oT>
+class AnalogResultCache {
+public:
+    /**
+     * @brief Constructor of the AnalogResultCache class.
+     * @param num_tiles Number of tiles covered (usually AnalogContext::get_num_arrays()).
+     * @param capacity Maximum number of entries kept per tile.
+     */
+    AnalogResultCache(uint32_t num_tiles, uint32_t capacity)
+        : capacity(capacity),
+          tiles(num_tiles),
+          hits(0),
+          misses(0),
+          evictions(0) {}
+
+    AnalogResultCache(const AnalogResultCache&) = delete;
+    AnalogResultCache& operator=(const AnalogResultCache&) = delete;
+
+    /**
+     * @brief Looks up the output codes for an input on a tile.
+     * @param tile_id The ID of the tile.
+     * @param version The current matrix version of the tile.
+     * @param offset The input code offset.
+     * @param input The quantized input codes.
+     * @param length Number of input codes.
+     * @param output Receives DEVICE_ROWS output codes on a hit.
+     * @return Whether the entry was found.
+     */
+    bool lookup(uint16_t tile_id, uint64_t version, int64_t offset, const qT* input, uint32_t length, oT* output) {
+        TileCache &tile = sync(tile_id, version);
+        uint64_t key = make_key(offset, input, length);
+        auto it = tile.index.find(key);
+        if (it == tile.index.end() || !matches(*it->second, offset, input, length)) {
+            misses++;
+            return false;
+        }
+        tile.lru.splice(tile.lru.begin(), tile.lru, it->second);
+        std::memcpy(output, it->second->output.data(), sizeof(oT) * DEVICE_ROWS);
+        hits++;
+        return true;
+    }
+
+    /**
+     * @brief Inserts the output codes for an input on a tile, evicting the least recently used entry if full.
+     * @param tile_id The ID of the tile.
+     * @param version The current matrix version of the tile.
+     * @param offset The input code offset.
+     * @param input The quantized input codes.
+     * @param length Number of input codes.
+     * @param output DEVICE_ROWS output codes.
+     */
+    void insert(uint16_t tile_id, uint64_t version, int64_t offset, const qT* input, uint32_t length, const oT* output) {
+        if (capacity == 0) {
+            return;
+        }
+        TileCache &tile = sync(tile_id, version);
+        uint64_t key = make_key(offset, input, length);
+        auto it = tile.index.find(key);
+        if (it != tile.index.end()) {
+            // Same key (possibly a hash collision): replace the entry in place
+            tile.lru.erase(it->second);
+            tile.index.erase(it);
+        } else if (tile.lru.size() >= capacity) {
+            tile.index.erase(tile.lru.back().key);
+            tile.lru.pop_back();
+            evictions++;
+        }
+        Entry entry;
+        entry.key = key;
+        entry.offset = offset;
+        entry.input.assign(input, input + length);
+        entry.output.assign(output, output + DEVICE_ROWS);
+        tile.lru.push_front(std::move(entry));
+        tile.index[key] = tile.lru.begin();
+    }
+
+    /**
+     * @brief Drops every entry of a tile.
+     */
+    void invalidate(uint16_t tile_id) {
+        tiles[tile_id].lru.clear();
+        tiles[tile_id].index.clear();
+    }
+
+    /**
+     * @brief Drops every entry.
+     */
+    void clear() {
+        for (uint32_t t = 0; t < tiles.size(); t++) {
+            invalidate(static_cast<uint16_t>(t));
+        }
+    }
+
+    uint64_t get_hits() const { return hits; }
+    uint64_t get_misses() const { return misses; }
+    uint64_t get_evictions() const { return evictions; }
+
+    /**
+     * @brief Returns hits / (hits + misses), or 0 before the first lookup.
+     */
+    double get_hit_rate() const {
+        uint64_t total = hits + misses;
+        return total ? static_cast<double>(hits) / total : 0.0;
+    }
+
+    void reset_counters() {
+        hits = 0;
+        misses = 0;
+        evictions = 0;
+    }
+
+    /**
+     * @brief Returns the number of entries currently held for a tile.
+     */
+    uint32_t get_size(uint16_t tile_id) const {
+        return static_cast<uint32_t>(tiles[tile_id].lru.size());
+    }
+
+private:
+    struct Entry {
+        uint64_t key;            ///< Hash of offset and input codes.
+        int64_t offset;          ///< Input code offset.
+        std::vector<qT> input;   ///< Input codes, compared on lookup to rule out collisions.
+        std::vector<oT> output;  ///< Output codes (DEVICE_ROWS).
+    };
+
+    struct TileCache {
+        TileCache() : version(0) {}
+
+        uint64_t version;                                                ///< Matrix version the entries belong to.
+        std::list<Entry> lru;                                            ///< Entries, most recently used first.
+        std::unordered_map<uint64_t, typename std::list<Entry>::iterator> index; ///< Key to entry.
+    };
+
+    /**
+     * @brief Returns the cache of a tile, dropping its entries if the tile was reprogrammed.
+     */
+    TileCache& sync(uint16_t tile_id, uint64_t version) {
+        TileCache &tile = tiles[tile_id];
+        if (tile.version != version) {
+            tile.lru.clear();
+            tile.index.clear();
+            tile.version = version;
+        }
+        return tile;
+    }
+
+    static uint64_t make_key(int64_t offset, const qT* input, uint32_t length) {
+        return analog_hash_bytes(input, sizeof(qT) * length, analog_hash_bytes(&offset, sizeof(offset)));
+    }
+
+    static bool matches(const Entry &entry, int64_t offset, const qT* input, uint32_t length) {
+        return entry.offset == offset && entry.input.size() == length &&
+               std::memcmp(entry.input.data(), input, sizeof(qT) * length) == 0;
+    }
+
+    uint32_t capacity;              ///< Maximum entries per tile.
+    std::vector<TileCache> tiles;   ///< One LRU per tile.
+    uint64_t hits;                  ///< Lookups answered from the cache.
+    uint64_t misses;                ///< Lookups that required an MVM.
+    uint64_t evictions;             ///< Entries dropped to respect the capacity.
+};
+
+/**
+ * @brief Loads, computes and stores a vector on a tile, answering repeated inputs from a cache.
+ *
+ * Equivalent to mvm_load_vector, mvm_compute and mvm_store_vector; on a hit only the context
+ * and scale bookkeeping of those calls is performed.
+ * @param ctx The analog context managing the scales.
+ * @param cache The result cache.
+ * @param in The input vector (quantized here).
+ * @param out The output vector (dequantized here).
+ * @param tile_id The ID of the tile.
+ * @return The status flag of the last intrinsic issued, or 0 on a hit.
+ */
+template <typename T, typename qT, typename oT>
+uint16_t mvm_compute_cached(AnalogContext &ctx, AnalogResultCache<qT, oT> &cache,
+                            AnalogVector<T, qT> &in, AnalogVector<T, oT> &out, uint16_t tile_id) {
+    in.transfer_to_device();
+    uint64_t version = ctx.get_matrix_version(tile_id);
+    if (cache.lookup(tile_id, version, in.get_input_offset(), in.get_device_arr(), in.get_device_length(),
+                     out.get_device_arr())) {
+        ctx.set_input_vector(&in, tile_id);
+        ctx.set_input_offset(in.get_input_offset(), tile_id);
+        ctx.compute_update(tile_id);
+        in.update_scale_factor(ctx.get_matrix(tile_id)->get_scale_factor());
+        out.transfer_to_host(in.get_scale_factor());
+        return 0;
+    }
+
+    mvm_load_device_vector(ctx, in, tile_id);
+    mvm_compute(ctx, tile_id);
+    uint16_t status_flag = mvm_store_vector(ctx, out, tile_id);
+    cache.insert(tile_id, version, in.get_input_offset(), in.get_device_arr(), in.get_device_length(),
+                 out.get_device_arr());
+    return status_flag;
+}
+
+#endif // ANALOG_CACHE_H
@@ -7,12 +7,42 @@
 #define ANALOG_CONTEXT_H
 
 #include <iostream>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <new>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "analogType.h"
 
+/**
+ * @brief 64-bit FNV-1a hash of a byte range.
+ * @param data Bytes to hash.
+ * @param size Number of bytes.
+ * @param seed Initial hash value, to chain several ranges.
+ */
+inline uint64_t analog_hash_bytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ULL) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Immutable snapshot of the tile bindings (logical tile -> backing tile); never null, starts as the identity map.
+ */
+typedef std::shared_ptr<const std::vector<uint32_t>> AnalogBindings;
+
 /**
  * @class AnalogContext
  * @brief The AnalogContext class keeps track of array scale factors.
@@ -21,32 +51,265 @@ class AnalogContext {
 public:
     /**
      * @brief Constructor of the AnalogContext class.
+     *
+     * By default tile IDs are physical tiles. With num_physical_arrays > 0, tile IDs become
+     * logical: mvm_set_matrix hashes the quantized device block and binds logical tiles with
+     * byte-identical blocks to one reference-counted physical tile, so more matrices fit than
+     * there are physical tiles.
      * @param num_arrays The number of arrays for which scales are maintained.
+     * @param num_physical_arrays The number of physical tiles shared by deduplication (0 disables it).
      */
-    AnalogContext(uint32_t num_arrays)
+    AnalogContext(uint32_t num_arrays, uint32_t num_physical_arrays = 0)
         : num_arrays(num_arrays),
           matrices(nullptr),
           input_vectors(nullptr),
-          output_vectors(nullptr) {
+          output_vectors(nullptr),
+          row_sums(nullptr),
+          input_offsets(nullptr),
+          matrix_versions(nullptr),
+          program_times(nullptr),
+          num_physical(num_physical_arrays),
+          shared_bindings(0) {
         // Allocate memory for the scales using new
         matrices = new AnalogType*[num_arrays];
         input_vectors = new AnalogType*[num_arrays];
         output_vectors = new AnalogType*[num_arrays];
+        row_sums = new const int64_t*[num_arrays];
+        input_offsets = new int64_t[num_arrays];
+        matrix_versions = new uint64_t[num_arrays];
+        program_times = new std::atomic<int64_t>[num_arrays];
 
         for (int i = 0; i < num_arrays; i++) {
             matrices[i] = nullptr;
             input_vectors[i] = nullptr;
             output_vectors[i] = nullptr;
+            row_sums[i] = nullptr;
+            input_offsets[i] = 0;
+            matrix_versions[i] = 0;
+            program_times[i].store(0);
         }
 
-        if (!matrices || !input_vectors || !output_vectors) {
+        if (!matrices || !input_vectors || !output_vectors || !row_sums || !input_offsets || !matrix_versions || !program_times) {
             std::cerr << "Memory allocation failed in AnalogContext constructor" << std::endl;
             exit(EXIT_FAILURE);
         }
+
+        // Start from an identity snapshot so requests holding it are tracked by wait_for_readers
+        std::shared_ptr<std::vector<uint32_t>> identity = std::make_shared<std::vector<uint32_t>>(num_arrays);
+        for (uint32_t i = 0; i < num_arrays; i++) {
+            (*identity)[i] = i;
+        }
+        bindings = identity;
+
+        if (num_physical > 0) {
+            physical.assign(num_arrays, 0);
+            bound.assign(num_arrays, 0);
+            ref_counts.assign(num_physical, 0);
+            physical_hashes.assign(num_physical, 0);
+            physical_codes.resize(num_physical);
+        }
+    }
+
+    /**
+     * @brief Returns whether identical device blocks share physical tiles.
+     */
+    bool is_deduplicating() const {
+        return num_physical > 0;
+    }
+
+    /**
+     * @brief Returns the physical tile a logical tile is bound to (the tile itself without deduplication).
+     */
+    uint32_t get_physical_tile(uint32_t tile_id) const {
+        return num_physical > 0 && bound[tile_id] ? physical[tile_id] : tile_id;
+    }
+
+    /**
+     * @brief Binds a logical tile to a physical tile holding the given device block.
+     *
+     * Without deduplication the tile is its own physical tile. With deduplication, a physical
+     * tile already holding byte-identical codes is shared (its reference count is raised and
+     * nothing has to be programmed); otherwise a free physical tile is claimed, preferring the
+     * one with the same ID. Logical tiles sharing a physical tile also share its input and output
+     * registers, so each load/compute/store sequence must complete before another starts.
+     * @param tile_id The logical tile.
+     * @param codes The quantized device block.
+     * @param bytes Size of the device block in bytes.
+     * @param program Set to whether the block still has to be programmed on the returned tile.
+     * @return The physical tile.
+     */
+    uint32_t bind_tile(uint32_t tile_id, const void* codes, size_t bytes, bool &program) {
+        program = true;
+        if (num_physical == 0) {
+            return tile_id;
+        }
+        std::lock_guard<std::mutex> lock(dedup_mutex);
+        release_binding(tile_id);
+
+        uint64_t hash = analog_hash_bytes(codes, bytes);
+        auto range = tiles_by_hash.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            uint32_t p = it->second;
+            if (physical_codes[p].size() == bytes && std::memcmp(physical_codes[p].data(), codes, bytes) == 0) {
+                ref_counts[p]++;
+                physical[tile_id] = p;
+                bound[tile_id] = 1;
+                shared_bindings++;
+                program = false;
+                return p;
+            }
+        }
+
+        uint32_t p = tile_id < num_physical && ref_counts[tile_id] == 0 ? tile_id : num_physical;
+        for (uint32_t i = 0; p == num_physical && i < num_physical; i++) {
+            if (ref_counts[i] == 0) {
+                p = i;
+            }
+        }
+        if (p == num_physical) {
+            std::cerr << "Error: no free physical tile for logical tile " << tile_id << " ("
+                      << num_physical << " physical tiles in use)." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        const uint8_t* bytes_ptr = static_cast<const uint8_t*>(codes);
+        physical_codes[p].assign(bytes_ptr, bytes_ptr + bytes);
+        physical_hashes[p] = hash;
+        tiles_by_hash.emplace(hash, p);
+        ref_counts[p] = 1;
+        physical[tile_id] = p;
+        bound[tile_id] = 1;
+        return p;
+    }
+
+    /**
+     * @brief Drops the binding of a logical tile, freeing its physical tile when no other tile shares it.
+     * @param tile_id The logical tile.
+     */
+    void release_tile(uint32_t tile_id) {
+        if (num_physical == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(dedup_mutex);
+        release_binding(tile_id);
+    }
+
+    /**
+     * @brief Returns the number of logical tiles bound to a physical tile.
+     */
+    uint32_t get_ref_count(uint32_t physical_tile) const {
+        return num_physical > 0 ? ref_counts[physical_tile] : 0;
+    }
+
+    /**
+     * @brief Returns the number of physical tiles holding a block.
+     */
+    uint32_t get_physical_tiles_used() const {
+        uint32_t used = 0;
+        for (uint32_t count : ref_counts) {
+            used += count > 0;
+        }
+        return used;
+    }
+
+    /**
+     * @brief Returns how many bindings reused an existing physical tile instead of programming one.
+     */
+    uint64_t get_shared_bindings() const {
+        return shared_bindings;
+    }
+
+    /**
+     * @brief Returns the current tile bindings.
+     *
+     * Callers take one snapshot per request and resolve every tile through it, so a request
+     * never mixes old and new bindings; holding the snapshot also keeps the tiles it points to
+     * from being reprogrammed (see wait_for_readers).
+     */
+    AnalogBindings get_bindings() const {
+        return std::atomic_load(&bindings);
+    }
+
+    /**
+     * @brief Returns the backing tile of a logical tile in a bindings snapshot.
+     */
+    static uint32_t resolve_tile(const AnalogBindings &snapshot, uint32_t tile_id) {
+        return snapshot ? (*snapshot)[tile_id] : tile_id;
+    }
+
+    /**
+     * @brief Returns the backing tile of a logical tile in the current bindings.
+     */
+    uint32_t resolve_tile(uint32_t tile_id) const {
+        return resolve_tile(get_bindings(), tile_id);
+    }
+
+    /**
+     * @brief Atomically switches a logical tile to another backing tile (hot swap).
+     *
+     * Requests that already took a snapshot finish on the old backing tile; later requests use
+     * the new one.
+     * @param tile_id The logical tile.
+     * @param backing_id The tile now holding its matrix.
+     */
+    void rebind_tile(uint32_t tile_id, uint32_t backing_id) {
+        std::lock_guard<std::mutex> lock(bindings_mutex);
+        AnalogBindings current = std::atomic_load(&bindings);
+        std::shared_ptr<std::vector<uint32_t>> next = std::make_shared<std::vector<uint32_t>>(*current);
+        (*next)[tile_id] = backing_id;
+        std::atomic_store(&bindings, AnalogBindings(next));
+        retired.push_back(current);
+    }
+
+    /**
+     * @brief Blocks until no request still holds a bindings snapshot older than the current one.
+     *
+     * After it returns, tiles that are no longer bound can be reprogrammed safely.
+     */
+    void wait_for_readers() {
+        std::unique_lock<std::mutex> lock(bindings_mutex);
+        while (true) {
+            retired.remove_if([](const AnalogBindings &b) { return b.use_count() == 1; });
+            if (retired.empty()) {
+                return;
+            }
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+        }
+    }
+
+    /**
+     * @brief Returns the number of arrays (tiles) managed by the context.
+     */
+    uint32_t get_num_arrays() const {
+        return num_arrays;
     }
 
     void set_matrix(AnalogType* mat, uint32_t tile_id) {
         matrices[tile_id] = mat;
+        matrix_versions[tile_id]++;
+        mark_programmed(tile_id);
+    }
+
+    /**
+     * @brief Records that a tile was (re)programmed now, resetting its drift age.
+     */
+    void mark_programmed(uint32_t tile_id) {
+        program_times[tile_id].store(now_ns());
+    }
+
+    /**
+     * @brief Returns the seconds since a tile was last programmed (its drift age).
+     */
+    double get_programming_age(uint32_t tile_id) const {
+        return (now_ns() - program_times[tile_id].load()) * 1e-9;
+    }
+
+    /**
+     * @brief Returns how many times a matrix has been programmed on a tile; changes on every set_matrix.
+     */
+    uint64_t get_matrix_version(uint32_t tile_id) const {
+        return matrix_versions[tile_id];
     }
 
     AnalogType* get_matrix(uint32_t tile_id) {
@@ -61,12 +324,40 @@ public:
         return input_vectors[tile_id];
     }
 
+    /**
+     * @brief Records the per-row code sums of the matrix programmed on a tile.
+     * @param sums Pointer to DEVICE_ROWS sums (owned by the matrix), or nullptr.
+     * @param tile_id The ID of the tile.
+     */
+    void set_row_sums(const int64_t* sums, uint32_t tile_id) {
+        row_sums[tile_id] = sums;
+    }
+
+    const int64_t* get_row_sums(uint32_t tile_id) const {
+        return row_sums[tile_id];
+    }
+
+    /**
+     * @brief Records the code offset of the input loaded on a tile (non-zero for unsigned encodings).
+     * @param offset The offset subtracted from the input codes.
+     * @param tile_id The ID of the tile.
+     */
+    void set_input_offset(int64_t offset, uint32_t tile_id) {
+        input_offsets[tile_id] = offset;
+    }
+
+    int64_t get_input_offset(uint32_t tile_id) const {
+        return input_offsets[tile_id];
+    }
+
     void compute_update(uint32_t tile_id) {
         output_vectors[tile_id] = input_vectors[tile_id];
     }
 
     void move_vector(uint32_t tile_id, uint32_t tile_id_new) {
         input_vectors[tile_id_new] = output_vectors[tile_id];
+        // Moved outputs are raw signed accumulations; the offset of the source input is not re-applied.
+        input_offsets[tile_id_new] = 0;
     }
 
     /**
@@ -76,14 +367,63 @@ public:
         delete[] matrices;
         delete[] input_vectors;
         delete[] output_vectors;
+        delete[] row_sums;
+        delete[] input_offsets;
+        delete[] matrix_versions;
+        delete[] program_times;
     }
 
 
 private:
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief Drops the binding of a logical tile; dedup_mutex must be held.
+     */
+    void release_binding(uint32_t tile_id) {
+        if (!bound[tile_id]) {
+            return;
+        }
+        uint32_t p = physical[tile_id];
+        bound[tile_id] = 0;
+        if (--ref_counts[p] > 0) {
+            return;
+        }
+        auto range = tiles_by_hash.equal_range(physical_hashes[p]);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == p) {
+                tiles_by_hash.erase(it);
+                break;
+            }
+        }
+        physical_codes[p].clear();
+    }
+
     uint32_t num_arrays;    ///< Number of arrays
     AnalogType** matrices;
     AnalogType** input_vectors;
     AnalogType** output_vectors;
+    const int64_t** row_sums; ///< Per-tile row code sums of the programmed matrix.
+    int64_t* input_offsets;   ///< Per-tile code offset of the loaded input.
+    uint64_t* matrix_versions; ///< Per-tile programming counter.
+    std::atomic<int64_t>* program_times; ///< Per-tile time of the last programming (steady clock, ns).
+
+    uint32_t num_physical;                  ///< Physical tiles shared by deduplication (0 = off).
+    uint64_t shared_bindings;               ///< Bindings that reused a physical tile.
+    std::vector<uint32_t> physical;         ///< Physical tile of every logical tile.
+    std::vector<uint8_t> bound;             ///< Whether a logical tile is bound.
+    std::vector<uint32_t> ref_counts;       ///< Logical tiles bound to every physical tile.
+    std::vector<uint64_t> physical_hashes;  ///< Content hash of every physical tile.
+    std::vector<std::vector<uint8_t>> physical_codes;          ///< Device block of every physical tile.
+    std::unordered_multimap<uint64_t, uint32_t> tiles_by_hash; ///< Content hash to physical tile.
+    std::mutex dedup_mutex;                 ///< Guards the deduplication state.
+
+    AnalogBindings bindings;                ///< Current logical-to-backing tile map (identity until rebound).
+    std::list<AnalogBindings> retired;      ///< Replaced snapshots that requests may still hold.
+    std::mutex bindings_mutex;              ///< Serializes rebind_tile and wait_for_readers.
 };
 
 #endif // ANALOG_CONTEXT_H
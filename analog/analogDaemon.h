@@ -0,0 +1,641 @@
+/**
+ * @file analogDaemon.h
+ * @brief This file contains a local daemon that shares one device between processes, and its client.
+ *
+ * AnalogDaemon owns the AnalogContext and hands out tiles to clients, so several processes (e.g.
+ * pre-fork workers) can use one device without each assuming it owns every tile. A client
+ * connects over a Unix socket and receives a shared-memory region of vector slots through
+ * SCM_RIGHTS. Vectors never travel through the socket: the client writes x into a slot, sends a
+ * small request naming the tile and slot, and the daemon quantizes x from and writes y back into
+ * the same mapping. Requests may be pipelined; the daemon serves clients round-robin, one
+ * request per client per turn, on a single thread that is the only one touching the device.
+ * Client sockets are non-blocking and partial requests and unsent replies are buffered per
+ * client, so a slow or stalled client cannot hold up the others.
+ */
+
+#ifndef ANALOG_DAEMON_H
+#define ANALOG_DAEMON_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "analogMatrix.h"
+#include "analogVector.h"
+#include "analogContext.h"
+#include "analogOperations.h"
+
+/**
+ * @brief Request codes understood by AnalogDaemon.
+ */
+enum class AnalogDaemonOp : uint32_t {
+    ALLOC = 1,   ///< Reserve count contiguous tiles; replies with the first one.
+    FREE = 2,    ///< Release count tiles from tile.
+    PROGRAM = 3, ///< Program the rows x cols row-major weights in slot onto tile.
+    MVM = 4      ///< y = W x with x and y in slot, on tile.
+};
+
+/**
+ * @brief Fixed-size request sent from a client to the daemon.
+ */
+struct AnalogDaemonRequest {
+    uint32_t op;     ///< AnalogDaemonOp.
+    uint32_t tile;   ///< Tile the request applies to.
+    uint32_t count;  ///< Number of tiles (ALLOC, FREE).
+    uint32_t slot;   ///< Shared-memory slot (PROGRAM, MVM).
+    uint32_t rows;   ///< Matrix rows (PROGRAM).
+    uint32_t cols;   ///< Matrix columns (PROGRAM).
+};
+
+/**
+ * @brief Fixed-size reply; replies arrive in request order.
+ */
+struct AnalogDaemonReply {
+    int32_t status;  ///< 0 on success, negative on a rejected request, else the device status flag.
+    uint32_t value;  ///< First tile (ALLOC) or number of slots (connection reply).
+};
+
+/**
+ * @brief Number of T elements in one shared-memory slot: a full device block, or an input and an output vector.
+ */
+inline constexpr uint32_t analog_daemon_slot_elems() {
+    return DEVICE_ROWS * DEVICE_COLS > DEVICE_ROWS + DEVICE_COLS ? DEVICE_ROWS * DEVICE_COLS
+                                                                 : DEVICE_ROWS + DEVICE_COLS;
+}
+
+/**
+ * @class AnalogDaemon
+ * @brief Serves tile allocation, programming and mvm requests of local clients.
+ * @tparam T Host data type.
+ * @tparam qT Device data type of weights and inputs.
+ * @tparam oT Device data type of the outputs.
+ */
+template <typename T, typename qT = T, typename oT = qT>
+class AnalogDaemon {
+public:
+    /**
+     * @brief Constructor of the AnalogDaemon class; binds and listens on the socket.
+     * @param ctx The analog context; only the daemon thread may use it while the daemon runs.
+     * @param socket_path Path of the Unix socket; an existing file is replaced.
+     * @param num_slots Vector slots in the shared-memory region of every client.
+     */
+    AnalogDaemon(AnalogContext &ctx, const std::string &socket_path, uint32_t num_slots = 64)
+        : ctx(ctx),
+          socket_path(socket_path),
+          num_slots(num_slots > 0 ? num_slots : 1),
+          listen_fd(-1),
+          owner(ctx.get_num_arrays(), -1),
+          matrices(ctx.get_num_arrays()),
+          next_client(0),
+          free_tiles(ctx.get_num_arrays()),
+          requests(0),
+          stopping(false) {
+        sockaddr_un addr;
+        if (socket_path.size() >= sizeof(addr.sun_path)) {
+            std::cerr << "Error: socket path " << socket_path << " is too long." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strcpy(addr.sun_path, socket_path.c_str());
+        ::unlink(socket_path.c_str());
+        listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd < 0 || ::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(listen_fd, 64) != 0 || !set_nonblocking(listen_fd) || ::pipe(wake_pipe) != 0) {
+            std::cerr << "Error: cannot listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    AnalogDaemon(const AnalogDaemon&) = delete;
+    AnalogDaemon& operator=(const AnalogDaemon&) = delete;
+
+    ~AnalogDaemon() {
+        stop();
+        for (auto &c : clients) {
+            drop(*c);
+        }
+        ::close(listen_fd);
+        ::close(wake_pipe[0]);
+        ::close(wake_pipe[1]);
+        ::unlink(socket_path.c_str());
+    }
+
+    /**
+     * @brief Serves requests on the calling thread until stop is called.
+     */
+    void run() {
+        std::vector<pollfd> fds;
+        while (!stopping.load()) {
+            fds.clear();
+            fds.push_back({listen_fd, POLLIN, 0});
+            fds.push_back({wake_pipe[0], POLLIN, 0});
+            for (auto &c : clients) {
+                // Stop reading from a client that does not collect its replies
+                short events = c->out.size() < max_unsent * sizeof(AnalogDaemonReply) ? POLLIN : 0;
+                if (!c->out.empty()) {
+                    events |= POLLOUT;
+                }
+                fds.push_back({c->fd, events, 0});
+            }
+            if (::poll(fds.data(), fds.size(), -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::cerr << "Error: poll failed: " << std::strerror(errno) << std::endl;
+                return;
+            }
+            if (fds[0].revents & POLLIN) {
+                accept_client();
+            }
+            // One request per ready client per turn
+            for (size_t i = 2; i < fds.size(); i++) {
+                Client &c = *clients[i - 2];
+                if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                    serve(c);
+                }
+                if (c.fd >= 0 && !c.out.empty()) {
+                    flush(c);
+                }
+            }
+            clients.erase(std::remove_if(clients.begin(), clients.end(),
+                                         [](const std::unique_ptr<Client> &c) { return c->fd < 0; }),
+                          clients.end());
+        }
+    }
+
+    /**
+     * @brief Starts serving on a background thread.
+     */
+    void start() {
+        stop();
+        stopping.store(false);
+        worker = std::thread([this] { run(); });
+    }
+
+    /**
+     * @brief Stops serving; connected clients stay connected until the daemon is destroyed.
+     */
+    void stop() {
+        stopping.store(true);
+        char byte = 0;
+        if (::write(wake_pipe[1], &byte, 1) < 0) {
+            std::cerr << "Error: cannot wake the daemon thread." << std::endl;
+        }
+        if (worker.joinable()) {
+            worker.join();
+        }
+        while (true) {
+            pollfd p = {wake_pipe[0], POLLIN, 0};
+            if (::poll(&p, 1, 0) <= 0 || ::read(wake_pipe[0], &byte, 1) <= 0) {
+                break;
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the number of tiles not allocated to any client.
+     */
+    uint32_t get_free_tiles() const {
+        return free_tiles.load();
+    }
+
+    /**
+     * @brief Returns the number of requests served.
+     */
+    uint64_t get_requests() const {
+        return requests.load();
+    }
+
+private:
+    struct Client {
+        Client() : id(0), fd(-1), shm(nullptr), shm_bytes(0), in_bytes(0) {}
+
+        int id;                   ///< Owner ID in the tile table.
+        int fd;                   ///< Connection (-1 once closed).
+        T* shm;                   ///< Mapped slots.
+        size_t shm_bytes;         ///< Size of the mapping.
+        AnalogDaemonRequest in;   ///< Request being received.
+        size_t in_bytes;          ///< Bytes of in received so far.
+        std::vector<char> out;    ///< Replies not sent yet.
+    };
+
+    static const size_t max_unsent = 256; ///< Unsent replies after which a client is not read.
+
+    static bool set_nonblocking(int fd) {
+        int flags = ::fcntl(fd, F_GETFL, 0);
+        return flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+
+    void accept_client() {
+        int fd = ::accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        std::unique_ptr<Client> c(new Client());
+        c->id = next_client++;
+        c->fd = fd;
+        c->shm_bytes = static_cast<size_t>(num_slots) * analog_daemon_slot_elems() * sizeof(T);
+
+        std::string name = "/analog-daemon-" + std::to_string(::getpid()) + "-" + std::to_string(c->id);
+        int shm_fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (shm_fd >= 0) {
+            ::shm_unlink(name.c_str());
+        }
+        void* mem = MAP_FAILED;
+        if (shm_fd >= 0 && ::ftruncate(shm_fd, static_cast<off_t>(c->shm_bytes)) == 0) {
+            mem = ::mmap(nullptr, c->shm_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+        }
+        if (mem == MAP_FAILED) {
+            std::cerr << "Error: cannot create shared memory for a client: " << std::strerror(errno) << std::endl;
+            if (shm_fd >= 0) {
+                ::close(shm_fd);
+            }
+            ::close(fd);
+            return;
+        }
+        c->shm = static_cast<T*>(mem);
+
+        // The connection reply carries the region's descriptor
+        AnalogDaemonReply hello = {0, num_slots};
+        iovec iov = {&hello, sizeof(hello)};
+        char control[CMSG_SPACE(sizeof(int))];
+        std::memset(control, 0, sizeof(control));
+        msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &shm_fd, sizeof(int));
+        bool sent = ::sendmsg(fd, &msg, MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(hello));
+        ::close(shm_fd);
+        if (!sent || !set_nonblocking(fd)) {
+            drop(*c);
+            return;
+        }
+        clients.push_back(std::move(c));
+    }
+
+    /**
+     * @brief Reads what a client sent and answers its request once complete, or drops the client on EOF.
+     */
+    void serve(Client &c) {
+        ssize_t n = ::recv(c.fd, reinterpret_cast<char*>(&c.in) + c.in_bytes, sizeof(c.in) - c.in_bytes, 0);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            return;
+        }
+        if (n <= 0) {
+            drop(c);
+            return;
+        }
+        c.in_bytes += static_cast<size_t>(n);
+        if (c.in_bytes < sizeof(c.in)) {
+            return;
+        }
+        c.in_bytes = 0;
+        const AnalogDaemonRequest &req = c.in;
+        AnalogDaemonReply reply = {0, 0};
+        switch (static_cast<AnalogDaemonOp>(req.op)) {
+            case AnalogDaemonOp::ALLOC:
+                reply.status = allocate(c, req.count, reply.value);
+                break;
+            case AnalogDaemonOp::FREE:
+                reply.status = release(c, req.tile, req.count);
+                break;
+            case AnalogDaemonOp::PROGRAM:
+                reply.status = program(c, req);
+                break;
+            case AnalogDaemonOp::MVM:
+                reply.status = mvm(c, req);
+                break;
+            default:
+                reply.status = -1;
+                break;
+        }
+        requests++;
+        const char* bytes = reinterpret_cast<const char*>(&reply);
+        c.out.insert(c.out.end(), bytes, bytes + sizeof(reply));
+    }
+
+    /**
+     * @brief Sends as much of a client's pending replies as the socket accepts.
+     */
+    void flush(Client &c) {
+        ssize_t n = ::send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            return;
+        }
+        if (n < 0) {
+            drop(c);
+            return;
+        }
+        c.out.erase(c.out.begin(), c.out.begin() + n);
+    }
+
+    int32_t allocate(const Client &c, uint32_t count, uint32_t &first) {
+        uint32_t run = 0;
+        for (uint32_t t = 0; t < owner.size() && count > 0; t++) {
+            run = owner[t] < 0 ? run + 1 : 0;
+            if (run == count) {
+                first = t + 1 - count;
+                std::fill(owner.begin() + first, owner.begin() + first + count, c.id);
+                free_tiles -= count;
+                return 0;
+            }
+        }
+        return -1;
+    }
+
+    int32_t release(const Client &c, uint32_t first, uint32_t count) {
+        if (static_cast<uint64_t>(first) + count > owner.size()) {
+            return -1;
+        }
+        for (uint32_t t = first; t < first + count; t++) {
+            if (owner[t] != c.id) {
+                return -1;
+            }
+        }
+        for (uint32_t t = first; t < first + count; t++) {
+            free_tile(t);
+        }
+        return 0;
+    }
+
+    bool owns(const Client &c, uint32_t tile, uint32_t slot) const {
+        return tile < owner.size() && owner[tile] == c.id && slot < num_slots;
+    }
+
+    T* slot_data(const Client &c, uint32_t slot) const {
+        return c.shm + static_cast<size_t>(slot) * analog_daemon_slot_elems();
+    }
+
+    int32_t program(const Client &c, const AnalogDaemonRequest &req) {
+        if (!owns(c, req.tile, req.slot) || req.rows == 0 || req.cols == 0 ||
+            req.rows > DEVICE_ROWS || req.cols > DEVICE_COLS) {
+            return -1;
+        }
+        std::unique_ptr<AnalogMatrix<T, qT>> mat(new AnalogMatrix<T, qT>(
+            slot_data(c, req.slot), static_cast<uint16_t>(req.rows), static_cast<uint16_t>(req.cols)));
+        uint16_t status = mvm_set_matrix(ctx, *mat, static_cast<uint16_t>(req.tile));
+        matrices[req.tile] = std::move(mat);
+        return status;
+    }
+
+    int32_t mvm(const Client &c, const AnalogDaemonRequest &req) {
+        if (!owns(c, req.tile, req.slot) || !matrices[req.tile]) {
+            return -1;
+        }
+        const AnalogMatrix<T, qT> &mat = *matrices[req.tile];
+        T* x = slot_data(c, req.slot);
+        AnalogVector<T, qT> in(x, mat.get_host_cols());
+        AnalogVector<T, oT> out(x + DEVICE_COLS, mat.get_host_rows());
+        uint16_t tile = static_cast<uint16_t>(req.tile);
+        uint16_t status = mvm_load_vector(ctx, in, tile);
+        status |= mvm_compute(ctx, tile);
+        status |= mvm_store_vector(ctx, out, tile);
+        return status;
+    }
+
+    /**
+     * @brief Returns a tile to the free pool, forgetting its weights so the next owner must program it.
+     */
+    void free_tile(uint32_t tile) {
+        owner[tile] = -1;
+        free_tiles++;
+        matrices[tile].reset();
+        ctx.release_tile(tile);
+    }
+
+    /**
+     * @brief Closes a client's connection and mapping and releases its tiles.
+     */
+    void drop(Client &c) {
+        if (c.fd < 0) {
+            return;
+        }
+        for (uint32_t t = 0; t < owner.size(); t++) {
+            if (owner[t] == c.id) {
+                free_tile(t);
+            }
+        }
+        ::munmap(c.shm, c.shm_bytes);
+        ::close(c.fd);
+        c.fd = -1;
+    }
+
+    AnalogContext &ctx;            ///< Context of the shared device.
+    std::string socket_path;       ///< Path of the listening socket.
+    uint32_t num_slots;            ///< Slots per client.
+    int listen_fd;                 ///< Listening socket.
+    int wake_pipe[2];              ///< Wakes poll on stop.
+
+    std::vector<int> owner;        ///< Client ID owning every tile (-1 if free); daemon thread only.
+    std::vector<std::unique_ptr<AnalogMatrix<T, qT>>> matrices; ///< Matrix programmed on every tile.
+    std::vector<std::unique_ptr<Client>> clients; ///< Connected clients.
+    int next_client;               ///< ID of the next client.
+
+    std::atomic<uint32_t> free_tiles; ///< Tiles with owner -1, readable from any thread.
+    std::atomic<uint64_t> requests; ///< Requests served.
+    std::atomic<bool> stopping;    ///< Whether run should return.
+    std::thread worker;            ///< Thread of start.
+};
+
+/**
+ * @class AnalogDaemonClient
+ * @brief Connection of one process (or one thread of it) to an AnalogDaemon.
+ * @tparam T Host data type; must match the daemon's.
+ */
+template <typename T>
+class AnalogDaemonClient {
+public:
+    /**
+     * @brief Constructor of the AnalogDaemonClient class; connects and maps the slots.
+     * @param socket_path Path of the daemon's socket. Pre-fork workers connect after fork.
+     */
+    explicit AnalogDaemonClient(const std::string &socket_path)
+        : fd(::socket(AF_UNIX, SOCK_STREAM, 0)),
+          shm(nullptr),
+          shm_bytes(0),
+          num_slots(0),
+          in_flight(0) {
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            std::cerr << "Error: cannot connect to " << socket_path << ": " << std::strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        AnalogDaemonReply hello;
+        iovec iov = {&hello, sizeof(hello)};
+        char control[CMSG_SPACE(sizeof(int))];
+        msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        cmsghdr* cmsg = nullptr;
+        if (::recvmsg(fd, &msg, MSG_WAITALL) == static_cast<ssize_t>(sizeof(hello))) {
+            cmsg = CMSG_FIRSTHDR(&msg);
+        }
+        if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+            std::cerr << "Error: the daemon at " << socket_path << " sent no shared memory." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        int shm_fd;
+        std::memcpy(&shm_fd, CMSG_DATA(cmsg), sizeof(int));
+        num_slots = hello.value;
+        shm_bytes = static_cast<size_t>(num_slots) * analog_daemon_slot_elems() * sizeof(T);
+        void* mem = ::mmap(nullptr, shm_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+        ::close(shm_fd);
+        if (mem == MAP_FAILED) {
+            std::cerr << "Error: cannot map the daemon's shared memory: " << std::strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        shm = static_cast<T*>(mem);
+    }
+
+    AnalogDaemonClient(const AnalogDaemonClient&) = delete;
+    AnalogDaemonClient& operator=(const AnalogDaemonClient&) = delete;
+
+    /**
+     * @brief Disconnects; the daemon releases the client's tiles.
+     */
+    ~AnalogDaemonClient() {
+        ::munmap(shm, shm_bytes);
+        ::close(fd);
+    }
+
+    /**
+     * @brief Reserves contiguous tiles.
+     * @return The first tile, or -1 if no run of count free tiles exists.
+     */
+    int32_t alloc(uint32_t count) {
+        AnalogDaemonReply reply = call({static_cast<uint32_t>(AnalogDaemonOp::ALLOC), 0, count, 0, 0, 0});
+        return reply.status == 0 ? static_cast<int32_t>(reply.value) : -1;
+    }
+
+    /**
+     * @brief Releases tiles reserved with alloc.
+     */
+    bool free(uint32_t first_tile, uint32_t count) {
+        return call({static_cast<uint32_t>(AnalogDaemonOp::FREE), first_tile, count, 0, 0, 0}).status == 0;
+    }
+
+    /**
+     * @brief Programs a block of at most DEVICE_ROWS x DEVICE_COLS weights onto an owned tile.
+     * @param tile_id The tile.
+     * @param weights Row-major weights (rows x cols), staged through the given slot.
+     * @param slot Slot used for staging; must not have a request in flight.
+     */
+    bool program(uint16_t tile_id, const T* weights, uint32_t rows, uint32_t cols, uint32_t slot = 0) {
+        if (rows * cols > analog_daemon_slot_elems()) {
+            std::cerr << "Error: a " << rows << "x" << cols << " block does not fit a tile." << std::endl;
+            return false;
+        }
+        std::copy(weights, weights + static_cast<size_t>(rows) * cols, get_input(slot));
+        return call({static_cast<uint32_t>(AnalogDaemonOp::PROGRAM), tile_id, 0, slot, rows, cols}).status == 0;
+    }
+
+    /**
+     * @brief Returns the input vector of a slot (DEVICE_COLS elements, in shared memory).
+     */
+    T* get_input(uint32_t slot) const {
+        return shm + static_cast<size_t>(slot) * analog_daemon_slot_elems();
+    }
+
+    /**
+     * @brief Returns the output vector of a slot (DEVICE_ROWS elements, in shared memory).
+     */
+    T* get_output(uint32_t slot) const {
+        return get_input(slot) + DEVICE_COLS;
+    }
+
+    uint32_t get_num_slots() const {
+        return num_slots;
+    }
+
+    /**
+     * @brief Queues y = W x on a tile for the vectors of a slot without waiting.
+     */
+    bool submit(uint16_t tile_id, uint32_t slot) {
+        AnalogDaemonRequest req = {static_cast<uint32_t>(AnalogDaemonOp::MVM), tile_id, 0, slot, 0, 0};
+        if (::send(fd, &req, sizeof(req), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(req))) {
+            std::cerr << "Error: lost the connection to the daemon." << std::endl;
+            return false;
+        }
+        in_flight++;
+        return true;
+    }
+
+    /**
+     * @brief Waits for the oldest submitted request.
+     * @return Its status: 0 on success, negative if rejected.
+     */
+    int32_t complete() {
+        AnalogDaemonReply reply;
+        if (in_flight == 0 || !receive(reply)) {
+            return -1;
+        }
+        in_flight--;
+        return reply.status;
+    }
+
+    /**
+     * @brief Computes y = W x for the vectors of a slot and waits for it.
+     */
+    int32_t mvm(uint16_t tile_id, uint32_t slot) {
+        return submit(tile_id, slot) ? complete() : -1;
+    }
+
+private:
+    /**
+     * @brief Sends a request and waits for its reply; requests already in flight are not allowed.
+     */
+    AnalogDaemonReply call(const AnalogDaemonRequest &req) {
+        AnalogDaemonReply reply = {-1, 0};
+        if (in_flight != 0) {
+            std::cerr << "Error: " << in_flight << " mvm requests are still in flight." << std::endl;
+            return reply;
+        }
+        if (::send(fd, &req, sizeof(req), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(req)) || !receive(reply)) {
+            std::cerr << "Error: lost the connection to the daemon." << std::endl;
+            reply.status = -1;
+        }
+        return reply;
+    }
+
+    bool receive(AnalogDaemonReply &reply) {
+        return ::recv(fd, &reply, sizeof(reply), MSG_WAITALL) == static_cast<ssize_t>(sizeof(reply));
+    }
+
+    int fd;              ///< Connection to the daemon.
+    T* shm;              ///< Mapped slots.
+    size_t shm_bytes;    ///< Size of the mapping.
+    uint32_t num_slots;  ///< Number of slots.
+    uint32_t in_flight;  ///< Submitted requests without reply.
+};
+
+#endif // ANALOG_DAEMON_H
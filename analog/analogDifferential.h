@@ -0,0 +1,202 @@
+/**
+ * @file analogDifferential.h
+ * @brief This file contains differential (positive/negative) weight mappings for conductance-only crossbars.
+ */
+
+#ifndef ANALOG_DIFFERENTIAL_H
+#define ANALOG_DIFFERENTIAL_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "analogMatrix.h"
+#include "analogVector.h"
+#include "analogContext.h"
+#include "analogOperations.h"
+
+/**
+ * @brief How signed weights W = W+ - W- are laid out on non-negative conductances.
+ */
+enum class AnalogSignedMapping {
+    DUAL_TILE,        ///< W+ and W- on two tiles, outputs subtracted digitally (2 tiles, 2 MVMs).
+    INTERLEAVED_ROWS, ///< Rows 2i / 2i+1 hold W+ / W- of row i, subtracted digitally (2x rows, 1 MVM).
+    STACKED_INPUT     ///< [W+ | W-] driven with [x; -x], subtracted on-device (2x columns, 1 MVM).
+};
+
+/**
+ * @class AnalogDifferentialLinear
+ * @brief Layer y = W x whose signed weights are programmed as non-negative conductances.
+ *
+ * Both halves are quantized from W+ = max(W, 0) and W- = max(-W, 0), so wT may be an unsigned
+ * conductance type (e.g. uint8_t) and uses its full range. Inputs stay signed (qT).
+ * @tparam T Host data type.
+ * @tparam wT Device data type of the conductances.
+ * @tparam qT Device data type of the inputs.
+ * @tparam oT Device data type of the outputs.
+ */
+template <typename T, typename wT, typename qT, typename oT>
+class AnalogDifferentialLinear {
+public:
+    /**
+     * @brief Constructor of the AnalogDifferentialLinear class; splits and programs the weights.
+     * @param ctx The analog context managing the scales.
+     * @param weights Row-major signed weights (rows x cols).
+     * @param rows Number of output rows.
+     * @param cols Number of input columns.
+     * @param mapping Signed-weight scheme.
+     * @param first_tile The ID of the first tile used (DUAL_TILE also uses first_tile + 1).
+     */
+    AnalogDifferentialLinear(AnalogContext &ctx, T* weights, uint16_t rows, uint16_t cols,
+                             AnalogSignedMapping mapping, uint16_t first_tile)
+        : ctx(ctx),
+          rows(rows),
+          cols(cols),
+          mapping(mapping),
+          first_tile(first_tile),
+          dev_rows(mapping == AnalogSignedMapping::INTERLEAVED_ROWS ? 2 * rows : rows),
+          dev_cols(mapping == AnalogSignedMapping::STACKED_INPUT ? 2 * cols : cols) {
+        if (dev_rows > DEVICE_ROWS || dev_cols > DEVICE_COLS) {
+            std::cerr << "Error: differential mapping needs a " << dev_rows << "x" << dev_cols
+                      << " tile but the device is " << DEVICE_ROWS << "x" << DEVICE_COLS << "." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        if (first_tile + get_num_tiles() > ctx.get_num_arrays()) {
+            std::cerr << "Error: differential layer needs " << get_num_tiles() << " tiles from tile "
+                      << first_tile << " but the context has " << ctx.get_num_arrays() << "." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        std::vector<T> pos(static_cast<size_t>(dev_rows) * dev_cols, static_cast<T>(0));
+        std::vector<T> neg;
+        for (uint16_t i = 0; i < rows; i++) {
+            for (uint16_t j = 0; j < cols; j++) {
+                T w = weights[static_cast<size_t>(i) * cols + j];
+                T wp = w > 0 ? w : static_cast<T>(0);
+                T wn = w < 0 ? -w : static_cast<T>(0);
+                switch (mapping) {
+                case AnalogSignedMapping::DUAL_TILE:
+                    pos[i * dev_cols + j] = wp;
+                    break;
+                case AnalogSignedMapping::INTERLEAVED_ROWS:
+                    pos[(2 * i) * dev_cols + j] = wp;
+                    pos[(2 * i + 1) * dev_cols + j] = wn;
+                    break;
+                case AnalogSignedMapping::STACKED_INPUT:
+                    pos[i * dev_cols + j] = wp;
+                    pos[i * dev_cols + cols + j] = wn;
+                    break;
+                }
+            }
+        }
+
+        mat_pos.reset(new AnalogMatrix<T, wT>(pos.data(), dev_rows, dev_cols));
+        mvm_set_matrix(ctx, *mat_pos, first_tile);
+
+        if (mapping == AnalogSignedMapping::DUAL_TILE) {
+            neg.assign(static_cast<size_t>(rows) * cols, static_cast<T>(0));
+            for (size_t k = 0; k < neg.size(); k++) {
+                neg[k] = weights[k] < 0 ? -weights[k] : static_cast<T>(0);
+            }
+            mat_neg.reset(new AnalogMatrix<T, wT>(neg.data(), rows, cols));
+            mvm_set_matrix(ctx, *mat_neg, static_cast<uint16_t>(first_tile + 1));
+        }
+
+        in_vec.reset(new AnalogVector<T, qT>(dev_cols));
+        out_pos.reset(new AnalogVector<T, oT>(dev_rows));
+        if (mapping == AnalogSignedMapping::DUAL_TILE) {
+            out_neg.reset(new AnalogVector<T, oT>(rows));
+        }
+    }
+
+    AnalogDifferentialLinear(const AnalogDifferentialLinear&) = delete;
+    AnalogDifferentialLinear& operator=(const AnalogDifferentialLinear&) = delete;
+
+    /**
+     * @brief Computes y = W x.
+     * @param x Input vector (cols).
+     * @param y Output vector (rows).
+     */
+    void forward(T* x, T* y) {
+        T* in_host = in_vec->get_host_arr();
+        for (uint16_t j = 0; j < cols; j++) {
+            in_host[j] = x[j];
+            if (mapping == AnalogSignedMapping::STACKED_INPUT) {
+                in_host[cols + j] = -x[j];
+            }
+        }
+
+        mvm_load_vector(ctx, *in_vec, first_tile);
+        mvm_compute(ctx, first_tile);
+        mvm_store_vector(ctx, *out_pos, first_tile);
+        T* pos = out_pos->get_host_arr();
+
+        switch (mapping) {
+        case AnalogSignedMapping::DUAL_TILE: {
+            uint16_t tile_neg = static_cast<uint16_t>(first_tile + 1);
+            mvm_load_vector(ctx, *in_vec, tile_neg);
+            mvm_compute(ctx, tile_neg);
+            mvm_store_vector(ctx, *out_neg, tile_neg);
+            T* neg = out_neg->get_host_arr();
+            for (uint16_t i = 0; i < rows; i++) {
+                y[i] = pos[i] - neg[i];
+            }
+            break;
+        }
+        case AnalogSignedMapping::INTERLEAVED_ROWS:
+            for (uint16_t i = 0; i < rows; i++) {
+                y[i] = pos[2 * i] - pos[2 * i + 1];
+            }
+            break;
+        case AnalogSignedMapping::STACKED_INPUT:
+            for (uint16_t i = 0; i < rows; i++) {
+                y[i] = pos[i];
+            }
+            break;
+        }
+    }
+
+    /**
+     * @brief Returns the number of tiles the mapping occupies.
+     */
+    uint32_t get_num_tiles() const {
+        return mapping == AnalogSignedMapping::DUAL_TILE ? 2 : 1;
+    }
+
+    /**
+     * @brief Returns the number of MVMs issued per forward call.
+     */
+    uint32_t get_mvms_per_forward() const {
+        return mapping == AnalogSignedMapping::DUAL_TILE ? 2 : 1;
+    }
+
+    /**
+     * @brief Returns the number of crossbar cells holding conductances (area cost of the mapping).
+     */
+    uint32_t get_cells_used() const {
+        return get_num_tiles() * static_cast<uint32_t>(dev_rows) * dev_cols;
+    }
+
+    AnalogSignedMapping get_mapping() const {
+        return mapping;
+    }
+
+private:
+    AnalogContext &ctx;              ///< Context the conductances are programmed in.
+    uint16_t rows;                   ///< Number of output rows.
+    uint16_t cols;                   ///< Number of input columns.
+    AnalogSignedMapping mapping;     ///< Signed-weight scheme.
+    uint16_t first_tile;             ///< Tile holding W+ (or the combined layout).
+    uint16_t dev_rows;               ///< Rows used on the tile.
+    uint16_t dev_cols;               ///< Columns used on the tile.
+
+    std::unique_ptr<AnalogMatrix<T, wT>> mat_pos;  ///< W+ or the combined layout.
+    std::unique_ptr<AnalogMatrix<T, wT>> mat_neg;  ///< W- (DUAL_TILE only).
+    std::unique_ptr<AnalogVector<T, qT>> in_vec;   ///< Input staging.
+    std::unique_ptr<AnalogVector<T, oT>> out_pos;  ///< Output of the first tile.
+    std::unique_ptr<AnalogVector<T, oT>> out_neg;  ///< Output of the W- tile (DUAL_TILE only).
+};
+
+#endif // ANALOG_DIFFERENTIAL_H
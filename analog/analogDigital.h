@@ -0,0 +1,192 @@
+/**
+ * @file analogDigital.h
+ * @brief This file contains the digital (host CPU) GEMV backend operating on Analog data types.
+ *
+ * The kernels consume the same quantized device buffers that would be sent to a tile, so a layer
+ * can be executed on the host instead of the crossbar without changing its quantization.
+ * The AVX2/VNNI loops take 16 codes per step: digital AnalogLinear layers keep host-sized
+ * buffers and use them on full rows, while tile-sized blocks (tiled layers) only engage them when
+ * DEVICE_COLS >= 16 and otherwise run the scalar tail. RVV handles any length.
+ */
+
+#ifndef ANALOG_DIGITAL_H
+#define ANALOG_DIGITAL_H
+
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__riscv_v_intrinsic)
+#include <riscv_vector.h>
+#endif
+
+#include "analogMatrix.h"
+#include "analogVector.h"
+
+/**
+ * @brief Generic dot product used for types without a dedicated kernel.
+ * @param a First operand.
+ * @param b Second operand.
+ * @param n Number of elements.
+ * @return The dot product, accumulated in int64_t for integral types and double otherwise.
+ */
+template <typename qT>
+typename std::conditional<std::is_integral<qT>::value, int64_t, double>::type
+digital_dot(const qT* a, const qT* b, uint32_t n) {
+    typename std::conditional<std::is_integral<qT>::value, int64_t, double>::type acc = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        acc += static_cast<decltype(acc)>(a[i]) * static_cast<decltype(acc)>(b[i]);
+    }
+    return acc;
+}
+
+#if defined(__AVX2__)
+/**
+ * @brief Horizontal sum of eight int32 lanes.
+ */
+inline int32_t digital_hsum_epi32(__m256i v) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+}
+
+/**
+ * @brief Multiplies adjacent int16 pairs and adds them to the int32 accumulator lanes.
+ */
+inline __m256i digital_dpwssd(__m256i acc, __m256i a, __m256i b) {
+#if defined(__AVXVNNI__)
+    return _mm256_dpwssd_avx_epi32(acc, a, b);
+#elif defined(__AVX512VNNI__) && defined(__AVX512VL__)
+    return _mm256_dpwssd_epi32(acc, a, b);
+#else
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(a, b));
+#endif
+}
+#endif
+
+/**
+ * @brief int8 dot product accumulated in int32.
+ */
+inline int32_t digital_dot(const int8_t* a, const int8_t* b, uint32_t n) {
+    uint32_t i = 0;
+    int32_t acc = 0;
+#if defined(__AVX2__)
+    __m256i vacc = _mm256_setzero_si256();
+    for (; i + 16 <= n; i += 16) {
+        __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+        __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        vacc = digital_dpwssd(vacc, va, vb);
+    }
+    acc = digital_hsum_epi32(vacc);
+#elif defined(__riscv_v_intrinsic)
+    vint32m1_t vacc = __riscv_vmv_v_x_i32m1(0, 1);
+    while (i < n) {
+        size_t vl = __riscv_vsetvl_e8m1(n - i);
+        vint8m1_t va = __riscv_vle8_v_i8m1(a + i, vl);
+        vint8m1_t vb = __riscv_vle8_v_i8m1(b + i, vl);
+        vint16m2_t prod = __riscv_vwmul_vv_i16m2(va, vb, vl);
+        vacc = __riscv_vwredsum_vs_i16m2_i32m1(prod, vacc, vl);
+        i += vl;
+    }
+    acc = __riscv_vmv_x_s_i32m1_i32(vacc);
+#endif
+    for (; i < n; i++) {
+        acc += static_cast<int32_t>(a[i]) * static_cast<int32_t>(b[i]);
+    }
+    return acc;
+}
+
+/**
+ * @brief int16 dot product accumulated in int64.
+ */
+inline int64_t digital_dot(const int16_t* a, const int16_t* b, uint32_t n) {
+    uint32_t i = 0;
+    int64_t acc = 0;
+#if defined(__AVX2__)
+    // Pairwise products fit int32; widen to int64 before accumulating across the row.
+    __m256i vacc = _mm256_setzero_si256();
+    for (; i + 16 <= n; i += 16) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        __m256i pairs = _mm256_madd_epi16(va, vb);
+        vacc = _mm256_add_epi64(vacc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(pairs)));
+        vacc = _mm256_add_epi64(vacc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(pairs, 1)));
+    }
+    alignas(32) int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), vacc);
+    acc = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__riscv_v_intrinsic)
+    vint64m1_t vacc = __riscv_vmv_v_x_i64m1(0, 1);
+    while (i < n) {
+        size_t vl = __riscv_vsetvl_e16m1(n - i);
+        vint16m1_t va = __riscv_vle16_v_i16m1(a + i, vl);
+        vint16m1_t vb = __riscv_vle16_v_i16m1(b + i, vl);
+        vint32m2_t prod = __riscv_vwmul_vv_i32m2(va, vb, vl);
+        vacc = __riscv_vwredsum_vs_i32m2_i64m1(prod, vacc, vl);
+        i += vl;
+    }
+    acc = __riscv_vmv_x_s_i64m1_i64(vacc);
+#endif
+    for (; i < n; i++) {
+        acc += static_cast<int64_t>(a[i]) * static_cast<int64_t>(b[i]);
+    }
+    return acc;
+}
+
+/**
+ * @brief Computes out = mat * vec on the host.
+ * @param mat Row-major matrix with row stride ld.
+ * @param ld Row stride of mat in elements.
+ * @param vec Input vector of length cols.
+ * @param out Output vector of length rows.
+ * @param rows Number of rows to compute.
+ * @param cols Number of columns to compute.
+ */
+template <typename qT, typename oT>
+void digital_gemv(const qT* mat, uint32_t ld, const qT* vec, oT* out, uint32_t rows, uint32_t cols) {
+    for (uint32_t r = 0; r < rows; r++) {
+        out[r] = static_cast<oT>(digital_dot(mat + r * ld, vec, cols));
+    }
+}
+
+/**
+ * @brief Quantizes a matrix for the digital backend.
+ *
+ * Digital counterpart of mvm_set_matrix: the device matrix is prepared the same way but kept in
+ * host memory instead of being programmed on a tile.
+ * @param mat The matrix to prepare.
+ */
+template <typename T, typename qT = T>
+void digital_set_matrix(AnalogMatrix<T, qT> &mat) {
+    mat.transfer_to_device();
+}
+
+/**
+ * @brief Performs an MVM on the host CPU using the quantized device buffers.
+ *
+ * Digital counterpart of mvm_load_vector, mvm_compute and mvm_store_vector. The matrix must have
+ * been prepared with digital_set_matrix. The output scale is the product of the input and matrix
+ * scales, exactly as on the analog path.
+ * @param mat The prepared matrix.
+ * @param in The input vector (quantized here).
+ * @param out The output vector (dequantized here).
+ */
+template <typename T, typename qT, typename oT>
+void digital_mvm(AnalogMatrix<T, qT> &mat, AnalogVector<T, qT> &in, AnalogVector<T, oT> &out) {
+    in.transfer_to_device();
+    digital_gemv(mat.get_device_mat(), mat.get_device_cols(), in.get_device_arr(),
+                 out.get_device_arr(), mat.get_host_rows(), mat.get_host_cols());
+    if (in.get_input_offset() != 0) {
+        oT* acc = out.get_device_arr();
+        for (uint16_t i = 0; i < mat.get_host_rows(); i++) {
+            acc[i] = static_cast<oT>(acc[i] + in.get_input_offset() * mat.get_row_sums()[i]);
+        }
+    }
+    out.transfer_to_host(in.get_scale_factor() * mat.get_scale_factor());
+}
+
+#endif // ANALOG_DIGITAL_H
@@ -0,0 +1,240 @@
+/**
+ * @file analogKernels.h
+ * @brief This file contains host kernels (normalization, softmax, GELU, attention) run between analog MVMs.
+ *
+ * The kernels are portable C++ without intrinsics. Reductions keep ANALOG_KERNEL_LANES
+ * independent accumulators, which shortens the floating-point dependency chain; whether the
+ * lanes map onto vector registers is left to the compiler. Each reduction-based kernel has an
+ * "apply" form that consumes statistics gathered by AnalogMoments from the epilogue that
+ * produced the vector (AnalogVector::transfer_to_host or AnalogTiledLinear::forward), so the
+ * normalization needs no separate statistics pass; AnalogTransformerBlock does this for both of
+ * its norms.
+ */
+
+#ifndef ANALOG_KERNELS_H
+#define ANALOG_KERNELS_H
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "analogActivation.h"
+
+#define ANALOG_KERNEL_LANES 8 ///< Independent accumulators used by the host reductions.
+
+/**
+ * @struct AnalogMoments
+ * @brief Running sum, sum of squares and maximum of a vector.
+ */
+template <typename T>
+struct AnalogMoments {
+    AnalogMoments() : count(0), sum(0.0), sum_sq(0.0), max(-std::numeric_limits<T>::infinity()) {}
+
+    /**
+     * @brief Adds one element.
+     */
+    void add(T v) {
+        count++;
+        sum += v;
+        sum_sq += static_cast<double>(v) * v;
+        if (v > max) {
+            max = v;
+        }
+    }
+
+    double mean() const {
+        return count ? sum / count : 0.0;
+    }
+
+    double variance() const {
+        if (!count) {
+            return 0.0;
+        }
+        double m = mean();
+        double var = sum_sq / count - m * m;
+        return var > 0.0 ? var : 0.0;
+    }
+
+    double mean_square() const {
+        return count ? sum_sq / count : 0.0;
+    }
+
+    uint32_t count;  ///< Number of elements added.
+    double sum;      ///< Sum of the elements.
+    double sum_sq;   ///< Sum of the squared elements.
+    T max;           ///< Largest element.
+};
+
+/**
+ * @brief Computes the sum, sum of squares and maximum of a vector.
+ */
+template <typename T>
+AnalogMoments<T> analog_moments(const T* x, uint32_t n) {
+    T s[ANALOG_KERNEL_LANES] = {};
+    T sq[ANALOG_KERNEL_LANES] = {};
+    T mx[ANALOG_KERNEL_LANES];
+    for (uint32_t l = 0; l < ANALOG_KERNEL_LANES; l++) {
+        mx[l] = -std::numeric_limits<T>::infinity();
+    }
+    uint32_t i = 0;
+    for (; i + ANALOG_KERNEL_LANES <= n; i += ANALOG_KERNEL_LANES) {
+        for (uint32_t l = 0; l < ANALOG_KERNEL_LANES; l++) {
+            T v = x[i + l];
+            s[l] += v;
+            sq[l] += v * v;
+            mx[l] = v > mx[l] ? v : mx[l];
+        }
+    }
+    AnalogMoments<T> m;
+    for (uint32_t l = 0; l < ANALOG_KERNEL_LANES; l++) {
+        m.sum += s[l];
+        m.sum_sq += sq[l];
+        m.max = mx[l] > m.max ? mx[l] : m.max;
+    }
+    m.count = i;
+    for (; i < n; i++) {
+        m.add(x[i]);
+    }
+    return m;
+}
+
+/**
+ * @brief Dot product of two host vectors.
+ */
+template <typename T>
+T analog_dot(const T* a, const T* b, uint32_t n) {
+    T s[ANALOG_KERNEL_LANES] = {};
+    uint32_t i = 0;
+    for (; i + ANALOG_KERNEL_LANES <= n; i += ANALOG_KERNEL_LANES) {
+        for (uint32_t l = 0; l < ANALOG_KERNEL_LANES; l++) {
+            s[l] += a[i + l] * b[i + l];
+        }
+    }
+    T sum = 0;
+    for (uint32_t l = 0; l < ANALOG_KERNEL_LANES; l++) {
+        sum += s[l];
+    }
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief Computes y = A^T p for a row-major matrix A (rows x n) with row stride ld, i.e. the
+ *        p-weighted sum of the rows; the inner loop runs over contiguous elements.
+ */
+template <typename T>
+void analog_weighted_rows(const T* a, uint32_t ld, const T* p, uint32_t rows, T* y, uint32_t n) {
+    for (uint32_t j = 0; j < n; j++) {
+        y[j] = static_cast<T>(0);
+    }
+    for (uint32_t r = 0; r < rows; r++) {
+        const T* row = a + static_cast<size_t>(r) * ld;
+        T w = p[r];
+        for (uint32_t j = 0; j < n; j++) {
+            y[j] += w * row[j];
+        }
+    }
+}
+
+/**
+ * @brief Normalizes x in place with precomputed moments: (x - mean) / sqrt(var + eps) * gamma + beta.
+ * @param gamma Scale (n), may be nullptr for 1.
+ * @param beta Shift (n), may be nullptr for 0.
+ */
+template <typename T>
+void analog_layernorm_apply(T* x, uint32_t n, const AnalogMoments<T> &m,
+                            const T* gamma, const T* beta, T eps = static_cast<T>(1e-5)) {
+    T mean = static_cast<T>(m.mean());
+    T inv = static_cast<T>(1.0 / std::sqrt(m.variance() + eps));
+    for (uint32_t i = 0; i < n; i++) {
+        T v = (x[i] - mean) * inv;
+        if (gamma) {
+            v *= gamma[i];
+        }
+        if (beta) {
+            v += beta[i];
+        }
+        x[i] = v;
+    }
+}
+
+/**
+ * @brief LayerNorm in place.
+ */
+template <typename T>
+void analog_layernorm(T* x, uint32_t n, const T* gamma, const T* beta, T eps = static_cast<T>(1e-5)) {
+    analog_layernorm_apply(x, n, analog_moments(x, n), gamma, beta, eps);
+}
+
+/**
+ * @brief Normalizes x in place with precomputed moments: x / sqrt(mean(x^2) + eps) * gamma.
+ * @param gamma Scale (n), may be nullptr for 1.
+ */
+template <typename T>
+void analog_rmsnorm_apply(T* x, uint32_t n, const AnalogMoments<T> &m,
+                          const T* gamma, T eps = static_cast<T>(1e-6)) {
+    T inv = static_cast<T>(1.0 / std::sqrt(m.mean_square() + eps));
+    for (uint32_t i = 0; i < n; i++) {
+        x[i] = gamma ? x[i] * inv * gamma[i] : x[i] * inv;
+    }
+}
+
+/**
+ * @brief RMSNorm in place.
+ */
+template <typename T>
+void analog_rmsnorm(T* x, uint32_t n, const T* gamma, T eps = static_cast<T>(1e-6)) {
+    analog_rmsnorm_apply(x, n, analog_moments(x, n), gamma, eps);
+}
+
+/**
+ * @brief Softmax in place given the maximum of x.
+ */
+template <typename T>
+void analog_softmax_apply(T* x, uint32_t n, T max) {
+    T s[ANALOG_KERNEL_LANES] = {};
+    uint32_t i = 0;
+    for (; i + ANALOG_KERNEL_LANES <= n; i += ANALOG_KERNEL_LANES) {
+        for (uint32_t l = 0; l < ANALOG_KERNEL_LANES; l++) {
+            x[i + l] = std::exp(x[i + l] - max);
+            s[l] += x[i + l];
+        }
+    }
+    T sum = 0;
+    for (uint32_t l = 0; l < ANALOG_KERNEL_LANES; l++) {
+        sum += s[l];
+    }
+    for (; i < n; i++) {
+        x[i] = std::exp(x[i] - max);
+        sum += x[i];
+    }
+    T inv = static_cast<T>(1) / sum;
+    for (i = 0; i < n; i++) {
+        x[i] *= inv;
+    }
+}
+
+/**
+ * @brief Softmax in place.
+ */
+template <typename T>
+void analog_softmax(T* x, uint32_t n) {
+    if (n == 0) {
+        return;
+    }
+    analog_softmax_apply(x, n, analog_moments(x, n).max);
+}
+
+/**
+ * @brief GELU (tanh approximation) evaluated through a tanh lookup table.
+ */
+template <typename T, uint32_t N>
+T analog_gelu(T x, const AnalogLUT<T, N> &tanh_lut) {
+    const T k = static_cast<T>(0.7978845608028654); // sqrt(2 / pi)
+    T inner = k * (x + static_cast<T>(0.044715) * x * x * x);
+    return static_cast<T>(0.5) * x * (static_cast<T>(1) + tanh_lut(inner));
+}
+
+#endif // ANALOG_KERNELS_H
@@ -0,0 +1,208 @@
+/**
+ * @file analogLazy.h
+ * @brief This file contains lazily materialized layers that quantize and program their weights on first use.
+ *
+ * A lazy layer only records how to build itself; the first forward (or an explicit warmup)
+ * quantizes the weights and programs the tiles exactly once, even when several threads race
+ * for it. Seldom used layers therefore cost no startup time, and with a deduplicating
+ * AnalogContext (logical tiles over fewer physical tiles) they claim no physical tile until used.
+ */
+
+#ifndef ANALOG_LAZY_H
+#define ANALOG_LAZY_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "analogContext.h"
+#include "analogLinear.h"
+#include "analogTiled.h"
+#include "analogThreadPool.h"
+
+/**
+ * @class AnalogLazyBase
+ * @brief Type-erased handle to a lazy layer, used by analog_warmup.
+ */
+class AnalogLazyBase {
+public:
+    virtual ~AnalogLazyBase() {}
+
+    /**
+     * @brief Builds the layer if it has not been built yet; returns once it is ready.
+     */
+    virtual void materialize() = 0;
+
+    /**
+     * @brief Returns whether the layer has been built.
+     */
+    virtual bool is_ready() const = 0;
+};
+
+/**
+ * @class AnalogLazy
+ * @brief Layer built by a factory on first use, with once-semantics.
+ * @tparam Layer The layer type, e.g. AnalogLinear or AnalogTiledLinear.
+ */
+template <typename Layer>
+class AnalogLazy : public AnalogLazyBase {
+public:
+    /**
+     * @brief Constructor of the AnalogLazy class.
+     * @param factory Builds (quantizes and programs) the layer; called at most once.
+     */
+    explicit AnalogLazy(std::function<Layer*()> factory)
+        : factory(std::move(factory)),
+          ready(false),
+          seconds(0.0) {}
+
+    AnalogLazy(const AnalogLazy&) = delete;
+    AnalogLazy& operator=(const AnalogLazy&) = delete;
+
+    void materialize() override {
+        get();
+    }
+
+    bool is_ready() const override {
+        return ready.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Returns the layer, building it first if needed; concurrent first callers wait for one build.
+     */
+    Layer& get() {
+        if (!ready.load(std::memory_order_acquire)) {
+            std::call_once(once, [this] {
+                auto start = std::chrono::steady_clock::now();
+                layer.reset(factory());
+                factory = nullptr; // Drop captured weights
+                seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                ready.store(true, std::memory_order_release);
+            });
+        }
+        return *layer;
+    }
+
+    /**
+     * @brief Runs the layer's forward, building the layer first if needed.
+     */
+    template <typename... Args>
+    void forward(Args&&... args) {
+        get().forward(std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Returns the seconds the build took (0 before it ran).
+     */
+    double get_materialize_seconds() const {
+        return is_ready() ? seconds : 0.0;
+    }
+
+private:
+    std::function<Layer*()> factory;  ///< Builds the layer.
+    std::once_flag once;              ///< Guards the build.
+    std::unique_ptr<Layer> layer;     ///< The layer once built.
+    std::atomic<bool> ready;          ///< Whether layer is set.
+    double seconds;                   ///< Duration of the build.
+};
+
+/**
+ * @class AnalogLazyLinear
+ * @brief AnalogLinear (analog placement) built on first use.
+ * @tparam T Host data type.
+ * @tparam qT Device data type of weights and inputs.
+ * @tparam oT Device data type of the outputs.
+ */
+template <typename T, typename qT = T, typename oT = qT>
+class AnalogLazyLinear : public AnalogLazy<AnalogLinear<T, qT, oT>> {
+public:
+    /**
+     * @brief Constructor of the AnalogLazyLinear class.
+     * @param ctx The analog context managing the scales.
+     * @param weights Row-major weights (rows x cols).
+     * @param rows Number of output rows.
+     * @param cols Number of input columns.
+     * @param tile_id The ID of the tile used once built.
+     * @param copy Whether to copy the weights now; otherwise they must stay valid until the layer is built.
+     */
+    AnalogLazyLinear(AnalogContext &ctx, T* weights, uint16_t rows, uint16_t cols, uint16_t tile_id, bool copy = true)
+        : AnalogLazy<AnalogLinear<T, qT, oT>>(make_factory(ctx, weights, rows, cols, tile_id, copy)) {}
+
+private:
+    static std::function<AnalogLinear<T, qT, oT>*()> make_factory(AnalogContext &ctx, T* weights, uint16_t rows,
+                                                                  uint16_t cols, uint16_t tile_id, bool copy) {
+        std::shared_ptr<std::vector<T>> owned;
+        if (copy) {
+            owned = std::make_shared<std::vector<T>>(weights, weights + static_cast<size_t>(rows) * cols);
+        }
+        AnalogContext* context = &ctx;
+        return [context, weights, owned, rows, cols, tile_id]() {
+            return new AnalogLinear<T, qT, oT>(*context, owned ? owned->data() : weights, rows, cols,
+                                               AnalogPlacement::ANALOG, tile_id);
+        };
+    }
+};
+
+/**
+ * @class AnalogLazyTiledLinear
+ * @brief AnalogTiledLinear built on first use.
+ * @tparam T Host data type.
+ * @tparam qT Device data type of weights and inputs.
+ * @tparam oT Device data type of the outputs.
+ */
+template <typename T, typename qT = T, typename oT = qT>
+class AnalogLazyTiledLinear : public AnalogLazy<AnalogTiledLinear<T, qT, oT>> {
+public:
+    /**
+     * @brief Constructor of the AnalogLazyTiledLinear class.
+     * @param ctx The analog context managing the scales.
+     * @param weights Row-major weights (rows x cols).
+     * @param rows Number of output rows.
+     * @param cols Number of input columns.
+     * @param first_tile The ID of the first tile used once built.
+     * @param copy Whether to copy the weights now; otherwise they must stay valid until the layer is built.
+     * @param pool Optional threads that quantize the blocks during the build.
+     */
+    AnalogLazyTiledLinear(AnalogContext &ctx, T* weights, uint32_t rows, uint32_t cols, uint16_t first_tile,
+                          bool copy = true, AnalogThreadPool* pool = nullptr)
+        : AnalogLazy<AnalogTiledLinear<T, qT, oT>>(make_factory(ctx, weights, rows, cols, first_tile, copy, pool)) {}
+
+private:
+    static std::function<AnalogTiledLinear<T, qT, oT>*()> make_factory(AnalogContext &ctx, T* weights,
+                                                                       uint32_t rows, uint32_t cols,
+                                                                       uint16_t first_tile, bool copy,
+                                                                       AnalogThreadPool* pool) {
+        std::shared_ptr<std::vector<T>> owned;
+        if (copy) {
+            owned = std::make_shared<std::vector<T>>(weights, weights + static_cast<size_t>(rows) * cols);
+        }
+        AnalogContext* context = &ctx;
+        return [context, weights, owned, rows, cols, first_tile, pool]() {
+            return new AnalogTiledLinear<T, qT, oT>(*context, owned ? owned->data() : weights, rows, cols,
+                                                    first_tile, false, pool);
+        };
+    }
+};
+
+/**
+ * @brief Builds the given lazy layers ahead of their first use.
+ * @param layers Layers to build; layers that are already built are skipped.
+ * @param pool Optional threads building the layers concurrently (each on its own tiles); must not be
+ *             the pool an AnalogLazyTiledLinear quantizes with, since a worker would wait on its own queue.
+ */
+inline void analog_warmup(const std::vector<AnalogLazyBase*> &layers, AnalogThreadPool* pool = nullptr) {
+    if (!pool) {
+        for (AnalogLazyBase* layer : layers) {
+            layer->materialize();
+        }
+        return;
+    }
+    pool->parallel_for(0, static_cast<uint32_t>(layers.size()), [&layers](uint32_t i) { layers[i]->materialize(); });
+}
+
+#endif // ANALOG_LAZY_H
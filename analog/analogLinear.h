@@ -0,0 +1,376 @@
+/**
+ * @file analogLinear.h
+ * @brief This file contains the AnalogLinear layer, which runs either on an analog tile or on the host CPU.
+ */
+
+#ifndef ANALOG_LINEAR_H
+#define ANALOG_LINEAR_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "analogMatrix.h"
+#include "analogVector.h"
+#include "analogContext.h"
+#include "analogOperations.h"
+#include "analogDigital.h"
+#include "analogCache.h"
+
+/**
+ * @brief Where a layer is executed.
+ */
+enum class AnalogPlacement {
+    ANALOG,  ///< Weights are programmed on a tile and multiplied with mvm intrinsics.
+    DIGITAL  ///< Weights stay in host memory and are multiplied with the CPU GEMV backend.
+};
+
+/**
+ * @brief Suggests a placement for a layer.
+ *
+ * Layers whose weights change between calls (e.g. attention scores) would need a full
+ * mvm_set_matrix per call, and layers smaller than min_elements do not amortize the
+ * load/compute/store overhead; both run digitally. Layers flagged as noise sensitive
+ * are kept digital as well.
+ * @param rows Number of output rows of the layer.
+ * @param cols Number of input columns of the layer.
+ * @param dynamic_weights Whether the weights change between calls.
+ * @param noise_sensitive Whether the layer cannot tolerate analog noise.
+ * @param min_elements Smallest weight count worth placing on a tile.
+ * @return The suggested placement.
+ */
+inline AnalogPlacement suggest_placement(uint32_t rows, uint32_t cols, bool dynamic_weights,
+                                         bool noise_sensitive = false, uint32_t min_elements = 16) {
+    if (dynamic_weights || noise_sensitive || rows * cols < min_elements) {
+        return AnalogPlacement::DIGITAL;
+    }
+    return AnalogPlacement::ANALOG;
+}
+
+/**
+ * @class AnalogLinear
+ * @brief Fully connected layer y = W x placed on an analog tile or on the host CPU.
+ *
+ * Both placements share the AnalogMatrix/AnalogVector quantization, so a network can mix
+ * analog and digital layers freely and move a layer between them. The analog placement is a
+ * single device block of at most DEVICE_ROWS x DEVICE_COLS (larger layers use
+ * AnalogTiledLinear); the digital placement sizes its quantized buffers to the layer, so the
+ * vectorized host kernels run on full-length rows.
+ *
+ * With a shadow tile (enable_hot_swap), new weights are programmed on the tile that is not
+ * currently bound while requests keep running, and commit_weights switches the binding in the
+ * AnalogContext between requests.
+ * @tparam T Host data type.
+ * @tparam qT Device data type of weights and inputs.
+ * @tparam oT Device data type of the outputs.
+ */
+template <typename T, typename qT = T, typename oT = qT>
+class AnalogLinear {
+public:
+    /**
+     * @brief Constructor copying the weights.
+     * @param ctx The analog context managing the scales.
+     * @param weights Row-major weights (rows x cols).
+     * @param rows Number of output rows.
+     * @param cols Number of input columns.
+     * @param placement Where the layer is executed.
+     * @param tile_id The ID of the tile used for the analog placement.
+     */
+    AnalogLinear(AnalogContext &ctx, T* weights, uint16_t rows, uint16_t cols,
+                 AnalogPlacement placement, uint16_t tile_id = 0)
+        : ctx(ctx),
+          placement(placement),
+          tile_id(tile_id),
+          shadow_tile(tile_id),
+          staged(false),
+          in_vec(cols),
+          out_vec(rows),
+          cache(nullptr) {
+        check_shape(rows, cols, placement);
+        mats[0].reset(new AnalogMatrix<T, qT>(weights, rows, cols));
+        set_weights();
+    }
+
+    /**
+     * @brief Constructor referencing the caller's weight rows, for weights that change between calls.
+     * @param ctx The analog context managing the scales.
+     * @param weights Row pointers of the weights (rows x cols); must outlive the layer.
+     * @param rows Number of output rows.
+     * @param cols Number of input columns.
+     * @param placement Where the layer is executed.
+     * @param tile_id The ID of the tile used for the analog placement.
+     */
+    AnalogLinear(AnalogContext &ctx, T** weights, uint16_t rows, uint16_t cols,
+                 AnalogPlacement placement, uint16_t tile_id = 0)
+        : ctx(ctx),
+          placement(placement),
+          tile_id(tile_id),
+          shadow_tile(tile_id),
+          staged(false),
+          in_vec(cols),
+          out_vec(rows),
+          cache(nullptr) {
+        check_shape(rows, cols, placement);
+        mats[0].reset(new AnalogMatrix<T, qT>(weights, rows, cols));
+        set_weights();
+    }
+
+    AnalogLinear(const AnalogLinear&) = delete;
+    AnalogLinear& operator=(const AnalogLinear&) = delete;
+
+    /**
+     * @brief Quantizes the weights and, for the analog placement, programs them on the tile.
+     *
+     * Call again after the referenced weights changed.
+     * @return The status flag of mvm_set_matrix, or 0 for the digital placement.
+     */
+    uint16_t set_weights() {
+        uint16_t live = static_cast<uint16_t>(ctx.resolve_tile(tile_id));
+        fit_buffers(*mats[slot(live)]);
+        if (placement == AnalogPlacement::ANALOG) {
+            return mvm_set_matrix(ctx, *mats[slot(live)], live);
+        }
+        digital_set_matrix(*mats[slot(live)]);
+        return 0;
+    }
+
+    /**
+     * @brief Reserves a spare tile for zero-downtime weight updates (analog placement only).
+     * @param spare_tile_id The tile alternating with the layer's tile as the programmed copy.
+     */
+    void enable_hot_swap(uint16_t spare_tile_id) {
+        if (placement != AnalogPlacement::ANALOG || spare_tile_id == tile_id) {
+            std::cerr << "Error: hot swap needs the analog placement and a spare tile other than "
+                      << tile_id << "." << std::endl;
+            return;
+        }
+        shadow_tile = spare_tile_id;
+    }
+
+    /**
+     * @brief Quantizes new weights and programs them on the standby tile.
+     *
+     * Safe to call from a background thread while forward runs: it only touches the standby
+     * tile, after waiting for requests that still hold a binding to it. The weights take effect
+     * at commit_weights.
+     * @param weights Row-major weights (rows x cols), copied.
+     * @return The status flag of mvm_set_matrix.
+     */
+    uint16_t stage_weights(T* weights) {
+        if (shadow_tile == tile_id) {
+            std::cerr << "Error: stage_weights requires enable_hot_swap." << std::endl;
+            return 0;
+        }
+        uint16_t standby = standby_tile();
+        ctx.wait_for_readers();
+        mats[slot(standby)].reset(new AnalogMatrix<T, qT>(weights, out_vec.get_host_length(),
+                                                          in_vec.get_host_length()));
+        uint16_t status_flag = mvm_set_matrix(ctx, *mats[slot(standby)], standby);
+        staged = true;
+        return status_flag;
+    }
+
+    /**
+     * @brief Atomically switches the layer to the staged weights; in-flight requests finish on the old ones.
+     */
+    void commit_weights() {
+        if (!staged) {
+            std::cerr << "Error: commit_weights called without staged weights." << std::endl;
+            return;
+        }
+        ctx.rebind_tile(tile_id, standby_tile());
+        staged = false;
+    }
+
+    /**
+     * @brief Reprograms the layer's current weights to undo conductance drift (analog placement only).
+     *
+     * With hot swap enabled (and nothing staged) the weights are programmed on the standby tile
+     * and committed, so requests never wait on the reprogramming; otherwise the live tile is
+     * refreshed in place.
+     * @return The status flag of the programming call, or 0 for the digital placement.
+     */
+    uint16_t refresh() {
+        if (placement != AnalogPlacement::ANALOG) {
+            return 0;
+        }
+        uint16_t live = static_cast<uint16_t>(ctx.resolve_tile(tile_id));
+        if (shadow_tile == tile_id || staged) {
+            return mvm_refresh_matrix(ctx, *mats[slot(live)], live);
+        }
+        uint32_t rows = out_vec.get_host_length();
+        uint32_t cols = in_vec.get_host_length();
+        T** w = mats[slot(live)]->get_host_mat();
+        std::vector<T> copy(static_cast<size_t>(rows) * cols);
+        for (uint32_t i = 0; i < rows; i++) {
+            for (uint32_t j = 0; j < cols; j++) {
+                copy[static_cast<size_t>(i) * cols + j] = w[i][j];
+            }
+        }
+        uint16_t status_flag = stage_weights(copy.data());
+        commit_weights();
+        return status_flag;
+    }
+
+    /**
+     * @brief Computes y = W x.
+     * @param x Input vector (cols).
+     * @param y Output vector (rows).
+     */
+    void forward(T* x, T* y) {
+        T* in_host = in_vec.get_host_arr();
+        for (uint32_t i = 0; i < in_vec.get_host_length(); i++) {
+            in_host[i] = x[i];
+        }
+
+        // One bindings snapshot per request, so a concurrent commit_weights cannot split it
+        AnalogBindings bindings = ctx.get_bindings();
+        uint16_t live = static_cast<uint16_t>(AnalogContext::resolve_tile(bindings, tile_id));
+        AnalogMatrix<T, qT> &mat = *mats[slot(live)];
+
+        if (placement == AnalogPlacement::ANALOG && cache) {
+            mvm_compute_cached(ctx, *cache, in_vec, out_vec, live);
+        } else if (placement == AnalogPlacement::ANALOG) {
+            mvm_load_vector(ctx, in_vec, live);
+            mvm_compute(ctx, live);
+            mvm_store_vector(ctx, out_vec, live);
+        } else {
+            digital_mvm(mat, in_vec, out_vec);
+        }
+
+        T* out_host = out_vec.get_host_arr();
+        const std::vector<uint32_t> &outliers = in_vec.get_outliers();
+        if (outliers.empty()) {
+            for (uint32_t i = 0; i < out_vec.get_host_length(); i++) {
+                y[i] = out_host[i];
+            }
+            return;
+        }
+
+        // Outlier columns were zeroed on the quantized path; add them back in host precision.
+        T** w = mat.get_host_mat();
+        for (uint32_t i = 0; i < out_vec.get_host_length(); i++) {
+            double acc = out_host[i];
+            for (uint32_t j : outliers) {
+                acc += static_cast<double>(w[i][j]) * x[j];
+            }
+            y[i] = static_cast<T>(acc);
+        }
+    }
+
+    /**
+     * @brief Enables LLM.int8-style outlier decomposition of the input.
+     * @param threshold Magnitude above which an input column is computed digitally; 0 disables it.
+     * @see AnalogVector::set_outlier_threshold
+     */
+    void set_outlier_threshold(T threshold) {
+        in_vec.set_outlier_threshold(threshold);
+    }
+
+    /**
+     * @brief Selects the input encoding, e.g. UNSIGNED or AUTO for layers fed by a ReLU.
+     * @see AnalogVector::set_input_encoding
+     */
+    void set_input_encoding(AnalogInputEncoding encoding) {
+        in_vec.set_input_encoding(encoding);
+    }
+
+    /**
+     * @brief Answers repeated inputs of the analog placement from a result cache.
+     * @param result_cache The cache to use (shared between layers is fine), or nullptr to disable it.
+     */
+    void set_result_cache(AnalogResultCache<qT, oT>* result_cache) {
+        cache = result_cache;
+    }
+
+    /**
+     * @brief Moves the layer to another placement and re-prepares its weights.
+     * @param new_placement The new placement.
+     * @param new_tile_id The tile used if the new placement is analog.
+     */
+    void set_placement(AnalogPlacement new_placement, uint16_t new_tile_id) {
+        check_shape(static_cast<uint16_t>(out_vec.get_host_length()), static_cast<uint16_t>(in_vec.get_host_length()),
+                    new_placement);
+        mats[0] = std::move(mats[slot(static_cast<uint16_t>(ctx.resolve_tile(tile_id)))]);
+        placement = new_placement;
+        tile_id = new_tile_id;
+        shadow_tile = new_tile_id;
+        staged = false;
+        if (ctx.resolve_tile(tile_id) != tile_id) {
+            ctx.rebind_tile(tile_id, tile_id);
+        }
+        set_weights();
+    }
+
+    AnalogPlacement get_placement() const {
+        return placement;
+    }
+
+    uint16_t get_tile_id() const {
+        return tile_id;
+    }
+
+    AnalogMatrix<T, qT>& get_matrix() {
+        return *mats[slot(static_cast<uint16_t>(ctx.resolve_tile(tile_id)))];
+    }
+
+private:
+    /**
+     * @brief Rejects empty layers, and analog layers larger than one tile.
+     */
+    static void check_shape(uint16_t rows, uint16_t cols, AnalogPlacement placement) {
+        bool oversized = rows > DEVICE_ROWS || cols > DEVICE_COLS;
+        if (rows == 0 || cols == 0 || (placement == AnalogPlacement::ANALOG && oversized)) {
+            std::cerr << "Error: a " << rows << "x" << cols << " AnalogLinear does not fit a " << DEVICE_ROWS << "x"
+                      << DEVICE_COLS << " tile; use AnalogTiledLinear for larger layers." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /**
+     * @brief Sizes the quantized buffers for the placement: one tile block, or the layer's own shape.
+     */
+    void fit_buffers(AnalogMatrix<T, qT> &mat) {
+        uint16_t rows = static_cast<uint16_t>(out_vec.get_host_length());
+        uint16_t cols = static_cast<uint16_t>(in_vec.get_host_length());
+        if (placement == AnalogPlacement::ANALOG) {
+            mat.set_device_size(DEVICE_ROWS, DEVICE_COLS);
+            in_vec.set_device_length(DEVICE_ROWS > DEVICE_COLS ? DEVICE_ROWS : DEVICE_COLS);
+            out_vec.set_device_length(DEVICE_ROWS > DEVICE_COLS ? DEVICE_ROWS : DEVICE_COLS);
+        } else {
+            mat.set_device_size(rows, cols);
+            in_vec.set_device_length(cols);
+            out_vec.set_device_length(rows);
+        }
+    }
+
+    /**
+     * @brief Returns the matrix slot backing a tile (0 for the layer's tile, 1 for the spare).
+     */
+    int slot(uint16_t backing_id) const {
+        return backing_id == tile_id ? 0 : 1;
+    }
+
+    /**
+     * @brief Returns the tile that is not currently bound.
+     */
+    uint16_t standby_tile() const {
+        return ctx.resolve_tile(tile_id) == tile_id ? shadow_tile : tile_id;
+    }
+
+    AnalogContext &ctx;          ///< Context used for the analog placement.
+    AnalogPlacement placement;   ///< Current placement.
+    uint16_t tile_id;            ///< Tile used for the analog placement.
+
+    uint16_t shadow_tile;        ///< Spare tile for hot swaps (tile_id when disabled).
+    bool staged;                 ///< Whether stage_weights programmed the standby tile.
+
+    std::unique_ptr<AnalogMatrix<T, qT>> mats[2]; ///< Weights on tile_id and on shadow_tile.
+    AnalogVector<T, qT> in_vec;  ///< Input staging.
+    AnalogVector<T, oT> out_vec; ///< Output staging.
+    AnalogResultCache<qT, oT>* cache; ///< Optional result cache (analog placement only).
+};
+
+#endif // ANALOG_LINEAR_H
@@ -12,6 +12,7 @@
 #include <iomanip>
 #include <limits>
 #include <type_traits>
+#include <vector>
 #include <new>        // For std::nothrow
 #include <exception>  // For std::bad_alloc
 
@@ -38,12 +39,14 @@ public:
           device_mat(nullptr),
           device_rows(DEVICE_ROWS),
           device_cols(DEVICE_COLS),
-          owns_host_mat(false) 
+          owns_host_mat(false),
+          row_scaling(false),
+          prequantized(false)
     {
         static_assert(std::is_arithmetic<T>::value, "AnalogMatrix requires arithmetic data type");
         try {
             // Allocate memory for device_mat using new[]
-            device_mat = new qT[device_rows * device_cols]();
+            device_mat = new qT[static_cast<size_t>(device_rows) * device_cols]();
         } catch (const std::bad_alloc&) {
             std::cerr << "Memory allocation failed for device_mat" << std::endl;
             exit(EXIT_FAILURE);
@@ -63,7 +66,9 @@ public:
           device_mat(nullptr),
           device_rows(DEVICE_ROWS),
           device_cols(DEVICE_COLS),
-          owns_host_mat(true)
+          owns_host_mat(true),
+          row_scaling(false),
+          prequantized(false)
     {
         static_assert(std::is_arithmetic<T>::value, "AnalogMatrix requires arithmetic data type");
         try {
@@ -86,7 +91,7 @@ public:
 
         try {
             // Allocate memory for device_mat using new[]
-            device_mat = new qT[device_rows * device_cols]();
+            device_mat = new qT[static_cast<size_t>(device_rows) * device_cols]();
         } catch (const std::bad_alloc&) {
             std::cerr << "Memory allocation failed for device_mat" << std::endl;
             // Free previously allocated memory before exiting
@@ -95,6 +100,31 @@ public:
         }
     }
 
+    /**
+     * @brief Constructor for a device-only matrix filled with set_device_mat (no host copy).
+     * @param rows Number of valid rows of the device block.
+     * @param cols Number of valid columns of the device block.
+     */
+    AnalogMatrix(uint16_t rows, uint16_t cols)
+        : host_mat(nullptr),
+          host_rows(rows),
+          host_cols(cols),
+          device_mat(nullptr),
+          device_rows(DEVICE_ROWS),
+          device_cols(DEVICE_COLS),
+          owns_host_mat(false),
+          row_scaling(false),
+          prequantized(false)
+    {
+        static_assert(std::is_arithmetic<T>::value, "AnalogMatrix requires arithmetic data type");
+        try {
+            device_mat = new qT[static_cast<size_t>(device_rows) * device_cols]();
+        } catch (const std::bad_alloc&) {
+            std::cerr << "Memory allocation failed for device_mat" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
     /**
      * @brief Destructor to clean up allocated device matrix memory.
      */
@@ -124,7 +154,7 @@ public:
         // For integral types, perform direct copy
         for (uint16_t i = 0; i < host_rows; i++) {
             for (uint16_t j = 0; j < host_cols; j++) {
-                uint16_t device_index = i * device_cols + j;
+                size_t device_index = static_cast<size_t>(i) * device_cols + j;
                 device_mat[device_index] = host_mat[i][j];
             }
         }
@@ -148,7 +178,7 @@ public:
 
         try {
             // Allocate memory for device_mat using new[]
-            device_mat = new qT[device_rows * device_cols]();
+            device_mat = new qT[static_cast<size_t>(device_rows) * device_cols]();
         } catch (const std::bad_alloc&) {
             std::cerr << "Memory allocation failed for device_mat" << std::endl;
             exit(EXIT_FAILURE);
@@ -159,15 +189,22 @@ public:
             return;
         }
 
-        // Identify the scaling factor
+        // Identify the scaling factor (one per row with row scaling)
         double max_abs_value = 0.0f;
         for (uint16_t i = 0; i < host_rows; i++) {
+            double row_max = 0.0;
             for (uint16_t j = 0; j < host_cols; j++) {
                 double tmp_val = std::abs(host_mat[i][j]);
-                if (tmp_val > max_abs_value) {
-                    max_abs_value = tmp_val;
+                if (tmp_val > row_max) {
+                    row_max = tmp_val;
                 }
             }
+            if (row_scaling) {
+                row_scales[i] = (row_max == 0.0) ? 1.0 : row_max;
+            }
+            if (row_max > max_abs_value) {
+                max_abs_value = row_max;
+            }
         }
         scale_factor = (max_abs_value == 0.0f) ? 1.0f : max_abs_value;
 
@@ -176,9 +213,10 @@ public:
         qT min_type_limit = std::numeric_limits<qT>::min();
 
         for (uint16_t i = 0; i < host_rows; i++) {
+            double row_scale = row_scaling ? row_scales[i] : static_cast<double>(scale_factor);
             for (uint16_t j = 0; j < host_cols; j++) {
-                uint16_t device_index = i * device_cols + j;
-                double scaled_value = static_cast<double>(host_mat[i][j] / scale_factor * max_type_limit);
+                size_t device_index = static_cast<size_t>(i) * device_cols + j;
+                double scaled_value = static_cast<double>(host_mat[i][j] / row_scale * max_type_limit);
 
                 // Clamp the scaled value to the range of quant_type
                 if (scaled_value > static_cast<double>(max_type_limit)) {
@@ -192,10 +230,125 @@ public:
             }
         }
 
-        scale_factor /= std::numeric_limits<qT>::max();
+        // Row sums of the codes correct the output of offset-encoded (unsigned) inputs
+        row_sums.assign(device_rows, 0);
+        for (uint16_t i = 0; i < host_rows; i++) {
+            for (uint16_t j = 0; j < host_cols; j++) {
+                row_sums[i] += static_cast<int64_t>(device_mat[static_cast<size_t>(i) * device_cols + j]);
+            }
+        }
+
+        if (row_scaling) {
+            // Row scales are applied digitally after the store; the context sees a unit scale.
+            for (uint16_t i = 0; i < host_rows; i++) {
+                row_scales[i] /= std::numeric_limits<qT>::max();
+            }
+            scale_factor = 1.0;
+        } else {
+            scale_factor /= std::numeric_limits<qT>::max();
+        }
+    }
+
+    /**
+     * @brief Resizes the device matrix, e.g. to the host shape for the digital backend.
+     *
+     * Tiles need DEVICE_ROWS x DEVICE_COLS; host-only consumers may use any shape that holds the
+     * host matrix. The codes are cleared, so call before transfer_to_device.
+     * @param rows Number of device rows (>= host rows).
+     * @param cols Number of device columns, i.e. the row stride of the codes (>= host columns).
+     */
+    void set_device_size(uint16_t rows, uint16_t cols) {
+        if (rows < host_rows || cols < host_cols) {
+            std::cerr << "Error: a " << rows << "x" << cols << " device matrix cannot hold " << host_rows << "x"
+                      << host_cols << " host weights." << std::endl;
+            return;
+        }
+        if (rows == device_rows && cols == device_cols) {
+            return;
+        }
+        delete[] device_mat;
+        device_rows = rows;
+        device_cols = cols;
+        try {
+            device_mat = new qT[static_cast<size_t>(device_rows) * device_cols]();
+        } catch (const std::bad_alloc&) {
+            std::cerr << "Memory allocation failed for device_mat" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        row_sums.clear();
+        prequantized = false;
+    }
+
+    /**
+     * @brief Enables one quantization scale per row instead of one per matrix.
+     *
+     * Each output row of an MVM is read out independently, so per-row scales survive the analog
+     * dot product. With row scaling the matrix reports a unit scale to the context and the
+     * caller multiplies output row i by get_row_scale(i).
+     * @param enable Whether to quantize rows independently.
+     */
+    void set_row_scaling(bool enable) {
+        row_scaling = enable;
+        row_scales.assign(enable ? host_rows : 0, 1.0);
+    }
+
+    /**
+     * @brief Returns whether row scaling is enabled.
+     */
+    bool has_row_scaling() const {
+        return row_scaling;
+    }
+
+    /**
+     * @brief Returns the dequantization scale of a row (1 without row scaling).
+     */
+    double get_row_scale(uint16_t row) const {
+        return row_scaling ? row_scales[row] : 1.0;
+    }
+
+    /**
+     * @brief Returns the sums of the quantized codes of each device row.
+     *
+     * An input quantized with an unsigned offset encoding (see AnalogVector::set_input_encoding)
+     * produces W (u - offset) on the tile; adding offset * row_sum restores W u.
+     * @return Pointer to device_rows sums, or nullptr if the matrix was not quantized.
+     */
+    const int64_t* get_row_sums() const {
+        return row_sums.empty() ? nullptr : row_sums.data();
+    }
+
+    /**
+     * @brief Loads already quantized device codes, e.g. read back from storage.
+     *
+     * transfer_to_device leaves the codes untouched afterwards, so the matrix can be passed to
+     * mvm_set_matrix without host weights.
+     * @param codes device_rows x device_cols codes.
+     * @param scale Dequantization scale of the matrix (as returned by get_scale_factor).
+     * @param scales Per-row dequantization scales (as returned by get_row_scale), or nullptr without row scaling.
+     */
+    void set_device_mat(const qT* codes, double scale, const double* scales = nullptr) {
+        for (uint32_t i = 0; i < static_cast<uint32_t>(device_rows) * device_cols; i++) {
+            device_mat[i] = codes[i];
+        }
+        scale_factor = scale;
+        row_scaling = scales != nullptr;
+        row_scales.assign(row_scaling ? host_rows : 0, 1.0);
+        for (uint16_t i = 0; row_scaling && i < host_rows; i++) {
+            row_scales[i] = scales[i];
+        }
+        row_sums.assign(device_rows, 0);
+        for (uint16_t i = 0; i < host_rows; i++) {
+            for (uint16_t j = 0; j < host_cols; j++) {
+                row_sums[i] += static_cast<int64_t>(device_mat[static_cast<size_t>(i) * device_cols + j]);
+            }
+        }
+        prequantized = true;
     }
 
     void transfer_to_device() {
+        if (prequantized) {
+            return;
+        }
         if (std::is_same<T, qT>::value) {
             direct_transfer_to_device();
         } else {
@@ -211,6 +364,42 @@ public:
         return device_mat;
     }
 
+    /**
+     * @brief Returns the host matrix.
+     * @return Row pointers of the host matrix.
+     */
+    T** get_host_mat() const {
+        return host_mat;
+    }
+
+    /**
+     * @brief Returns the number of rows in the host matrix.
+     */
+    uint16_t get_host_rows() const {
+        return host_rows;
+    }
+
+    /**
+     * @brief Returns the number of columns in the host matrix.
+     */
+    uint16_t get_host_cols() const {
+        return host_cols;
+    }
+
+    /**
+     * @brief Returns the number of rows in the device matrix.
+     */
+    uint16_t get_device_rows() const {
+        return device_rows;
+    }
+
+    /**
+     * @brief Returns the number of columns (row stride) of the device matrix.
+     */
+    uint16_t get_device_cols() const {
+        return device_cols;
+    }
+
     /**
      * @brief Prints the properties and content of the device matrix.
      */
@@ -242,7 +431,7 @@ public:
         for (uint16_t i = 0; i < device_rows; i++) {
             std::cout << "\t\t";
             for (uint16_t j = 0; j < device_cols; j++) {
-                uint16_t index = i * device_cols + j;
+                size_t index = static_cast<size_t>(i) * device_cols + j;
                 if (std::is_integral<T>::value) {
                     std::cout << std::setw(6)
                               << static_cast<int64_t>(device_mat[index]) << " ";
@@ -267,6 +456,11 @@ private:
     uint16_t device_cols; ///< Number of columns in the device matrix.
 
     bool owns_host_mat;   ///< Indicates if this object owns the host_mat memory
+
+    bool row_scaling;                ///< Whether each row has its own quantization scale.
+    std::vector<double> row_scales;  ///< Per-row dequantization scales (row scaling only).
+    std::vector<int64_t> row_sums;   ///< Per-row sums of the quantized codes.
+    bool prequantized;               ///< Whether the codes came from set_device_mat.
 };
 
 #endif // ANALOG_MATRIX_H
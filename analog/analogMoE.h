@@ -0,0 +1,307 @@
+/**
+ * @file analogMoE.h
+ * @brief This file contains a mixture-of-experts operator that schedules expert matrices onto tiles by demand.
+ *
+ * Only a few experts are resident at a time, each in a slot of tiles. A forward call groups its
+ * tokens by selected expert, runs the batches of resident experts first and then pages the
+ * remaining experts in with mvm_set_matrix, so every programmed expert serves its whole batch.
+ * Eviction prefers experts the current call does not need and, among those, the one with the
+ * lowest decayed demand, which keeps hot experts resident.
+ */
+
+#ifndef ANALOG_MOE_H
+#define ANALOG_MOE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "analogContext.h"
+#include "analogTiled.h"
+
+/**
+ * @brief Selects the top_k experts of every token from router logits, with softmax gates over the selection.
+ * @param logits Router logits (num_tokens x num_experts).
+ * @param num_tokens Number of tokens.
+ * @param num_experts Number of experts.
+ * @param top_k Experts per token.
+ * @param expert_ids Selected experts (num_tokens x top_k), by decreasing logit.
+ * @param gates Gate of every selection (num_tokens x top_k), summing to 1 per token.
+ */
+template <typename T>
+void analog_moe_route(const T* logits, uint32_t num_tokens, uint32_t num_experts, uint32_t top_k,
+                      uint32_t* expert_ids, T* gates) {
+    if (top_k > num_experts) {
+        std::cerr << "Error: cannot route to top " << top_k << " of " << num_experts << " experts." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::vector<uint32_t> order(num_experts);
+    for (uint32_t t = 0; t < num_tokens; t++) {
+        const T* l = logits + static_cast<size_t>(t) * num_experts;
+        for (uint32_t e = 0; e < num_experts; e++) {
+            order[e] = e;
+        }
+        std::partial_sort(order.begin(), order.begin() + top_k, order.end(),
+                          [l](uint32_t a, uint32_t b) { return l[a] > l[b] || (l[a] == l[b] && a < b); });
+        double sum = 0.0;
+        for (uint32_t k = 0; k < top_k; k++) {
+            sum += std::exp(static_cast<double>(l[order[k]] - l[order[0]]));
+        }
+        for (uint32_t k = 0; k < top_k; k++) {
+            expert_ids[t * top_k + k] = order[k];
+            gates[t * top_k + k] = static_cast<T>(std::exp(static_cast<double>(l[order[k]] - l[order[0]])) / sum);
+        }
+    }
+}
+
+/**
+ * @class AnalogMoE
+ * @brief Experts y = W_e x of equal shape, paged between host copies and a fixed number of tile slots.
+ * @tparam T Host data type.
+ * @tparam qT Device data type of weights and inputs.
+ * @tparam oT Device data type of the outputs.
+ */
+template <typename T, typename qT = T, typename oT = qT>
+class AnalogMoE {
+public:
+    /**
+     * @brief Constructor of the AnalogMoE class; copies the expert weights, programs nothing yet.
+     * @param ctx The analog context managing the scales.
+     * @param experts Row-major weights of every expert (rows x cols each).
+     * @param num_experts Number of experts.
+     * @param rows Number of output rows of an expert.
+     * @param cols Number of input columns of an expert.
+     * @param first_tile The ID of the first tile of the first slot.
+     * @param num_slots Number of experts resident at once; slot s starts at first_tile + s * tiles_per_expert.
+     * @param decay Factor applied to the demand of every expert once per forward call.
+     */
+    AnalogMoE(AnalogContext &ctx, T* const* experts, uint32_t num_experts, uint32_t rows, uint32_t cols,
+              uint16_t first_tile, uint32_t num_slots, double decay = 0.9)
+        : ctx(ctx),
+          num_experts(num_experts),
+          rows(rows),
+          cols(cols),
+          first_tile(first_tile),
+          tiles_per_expert(AnalogTiledLinear<T, qT, oT>::count_tiles(rows, cols)),
+          decay(decay),
+          weights(num_experts),
+          expert_slot(num_experts, -1),
+          demand(num_experts, 0.0),
+          expert_tokens(num_experts, 0),
+          expert_page_ins(num_experts, 0),
+          slot_layers(num_slots),
+          slot_expert(num_slots, -1),
+          hits(0),
+          page_ins(0),
+          evictions(0),
+          out_buf(rows) {
+        if (num_slots == 0 || first_tile + num_slots * tiles_per_expert > ctx.get_num_arrays()) {
+            std::cerr << "Error: " << num_slots << " expert slots of " << tiles_per_expert << " tiles from tile "
+                      << first_tile << " do not fit a context of " << ctx.get_num_arrays() << " tiles." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        for (uint32_t e = 0; e < num_experts; e++) {
+            weights[e].assign(experts[e], experts[e] + static_cast<size_t>(rows) * cols);
+        }
+    }
+
+    AnalogMoE(const AnalogMoE&) = delete;
+    AnalogMoE& operator=(const AnalogMoE&) = delete;
+
+    /**
+     * @brief Computes y_t = sum_k gate_tk W_{e_tk} x_t for a batch of tokens.
+     * @param x Inputs (num_tokens x cols).
+     * @param num_tokens Number of tokens.
+     * @param expert_ids Selected experts (num_tokens x top_k).
+     * @param gates Gate of every selection (num_tokens x top_k).
+     * @param top_k Experts per token.
+     * @param y Outputs (num_tokens x rows).
+     */
+    void forward(const T* x, uint32_t num_tokens, const uint32_t* expert_ids, const T* gates, uint32_t top_k, T* y) {
+        if (top_k > num_experts) {
+            std::cerr << "Error: cannot route to top " << top_k << " of " << num_experts << " experts." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < static_cast<size_t>(num_tokens) * rows; i++) {
+            y[i] = static_cast<T>(0);
+        }
+
+        // Group the (token, selection) pairs by expert
+        std::vector<std::vector<uint32_t>> groups(num_experts);
+        for (uint32_t t = 0; t < num_tokens; t++) {
+            for (uint32_t k = 0; k < top_k; k++) {
+                uint32_t e = expert_ids[t * top_k + k];
+                if (e >= num_experts) {
+                    std::cerr << "Error: token " << t << " selects expert " << e << " of " << num_experts << "." << std::endl;
+                    continue;
+                }
+                groups[e].push_back(t * top_k + k);
+            }
+        }
+        for (uint32_t e = 0; e < num_experts; e++) {
+            demand[e] = decay * demand[e] + groups[e].size();
+            expert_tokens[e] += groups[e].size();
+        }
+
+        // Resident experts first, then the others by decreasing batch size
+        std::vector<uint32_t> order;
+        for (uint32_t e = 0; e < num_experts; e++) {
+            if (!groups[e].empty()) {
+                order.push_back(e);
+            }
+        }
+        std::stable_sort(order.begin(), order.end(), [this, &groups](uint32_t a, uint32_t b) {
+            bool ra = expert_slot[a] >= 0;
+            bool rb = expert_slot[b] >= 0;
+            return ra != rb ? ra : groups[a].size() > groups[b].size();
+        });
+
+        std::vector<uint8_t> pending(num_experts, 0);
+        for (uint32_t e : order) {
+            pending[e] = 1;
+        }
+        T* out = out_buf.data();
+        for (uint32_t e : order) {
+            AnalogTiledLinear<T, qT, oT> &layer = resident(e, pending);
+            for (uint32_t sel : groups[e]) {
+                uint32_t t = sel / top_k;
+                layer.forward(const_cast<T*>(x + static_cast<size_t>(t) * cols), out);
+                T gate = gates[sel];
+                T* y_t = y + static_cast<size_t>(t) * rows;
+                for (uint32_t i = 0; i < rows; i++) {
+                    y_t[i] += gate * out[i];
+                }
+            }
+            pending[e] = 0;
+        }
+    }
+
+    /**
+     * @brief Programs an expert ahead of use (e.g. known hot experts at startup).
+     */
+    void pin(uint32_t expert) {
+        if (expert >= num_experts) {
+            std::cerr << "Error: cannot pin expert " << expert << " of " << num_experts << "." << std::endl;
+            return;
+        }
+        std::vector<uint8_t> pending(num_experts, 0);
+        pending[expert] = 1;
+        resident(expert, pending);
+    }
+
+    /**
+     * @brief Returns whether an expert currently occupies a slot.
+     */
+    bool is_resident(uint32_t expert) const {
+        return expert_slot[expert] >= 0;
+    }
+
+    /**
+     * @brief Returns the fraction of expert batches served without programming, or 0 before the first batch.
+     */
+    double get_hit_rate() const {
+        uint64_t total = hits + page_ins;
+        return total ? static_cast<double>(hits) / total : 0.0;
+    }
+
+    uint64_t get_hits() const { return hits; }
+    uint64_t get_page_ins() const { return page_ins; }
+    uint64_t get_evictions() const { return evictions; }
+
+    /**
+     * @brief Returns the number of (token, selection) pairs routed to an expert.
+     */
+    uint64_t get_expert_tokens(uint32_t expert) const { return expert_tokens[expert]; }
+
+    /**
+     * @brief Returns how often an expert was programmed onto a slot.
+     */
+    uint64_t get_expert_page_ins(uint32_t expert) const { return expert_page_ins[expert]; }
+
+    void reset_counters() {
+        hits = 0;
+        page_ins = 0;
+        evictions = 0;
+        std::fill(expert_tokens.begin(), expert_tokens.end(), 0);
+        std::fill(expert_page_ins.begin(), expert_page_ins.end(), 0);
+    }
+
+    uint32_t get_num_slots() const { return static_cast<uint32_t>(slot_layers.size()); }
+    uint32_t get_tiles_per_expert() const { return tiles_per_expert; }
+
+private:
+    /**
+     * @brief Returns the layer of an expert, paging it into a slot if needed.
+     * @param expert The expert.
+     * @param pending Experts the current call still has to run; evicted last.
+     */
+    AnalogTiledLinear<T, qT, oT>& resident(uint32_t expert, const std::vector<uint8_t> &pending) {
+        if (expert_slot[expert] >= 0) {
+            hits++;
+            return *slot_layers[expert_slot[expert]];
+        }
+
+        int victim = -1;
+        for (uint32_t s = 0; s < slot_layers.size(); s++) {
+            int held = slot_expert[s];
+            if (held < 0) {
+                victim = static_cast<int>(s);
+                break;
+            }
+            if (victim < 0 || evict_before(held, slot_expert[victim], pending)) {
+                victim = static_cast<int>(s);
+            }
+        }
+        if (slot_expert[victim] >= 0) {
+            expert_slot[slot_expert[victim]] = -1;
+            evictions++;
+        }
+
+        slot_layers[victim].reset();
+        slot_layers[victim].reset(new AnalogTiledLinear<T, qT, oT>(
+            ctx, weights[expert].data(), rows, cols, static_cast<uint16_t>(first_tile + victim * tiles_per_expert)));
+        slot_expert[victim] = static_cast<int>(expert);
+        expert_slot[expert] = victim;
+        page_ins++;
+        expert_page_ins[expert]++;
+        return *slot_layers[victim];
+    }
+
+    /**
+     * @brief Returns whether expert a should be evicted before expert b.
+     */
+    bool evict_before(int a, int b, const std::vector<uint8_t> &pending) const {
+        if (pending[a] != pending[b]) {
+            return !pending[a];
+        }
+        return demand[a] < demand[b];
+    }
+
+    AnalogContext &ctx;           ///< Context the experts are programmed in.
+    uint32_t num_experts;         ///< Number of experts.
+    uint32_t rows;                ///< Output rows of an expert.
+    uint32_t cols;                ///< Input columns of an expert.
+    uint16_t first_tile;          ///< First tile of slot 0.
+    uint32_t tiles_per_expert;    ///< Tiles of one slot.
+    double decay;                 ///< Per-call decay of the demand.
+
+    std::vector<std::vector<T>> weights;  ///< Host copy of every expert.
+    std::vector<int> expert_slot;         ///< Slot of every expert (-1 if paged out).
+    std::vector<double> demand;           ///< Decayed number of selections of every expert.
+    std::vector<uint64_t> expert_tokens;  ///< Selections of every expert.
+    std::vector<uint64_t> expert_page_ins; ///< Page-ins of every expert.
+
+    std::vector<std::unique_ptr<AnalogTiledLinear<T, qT, oT>>> slot_layers; ///< Expert programmed in every slot.
+    std::vector<int> slot_expert;         ///< Expert in every slot (-1 if empty).
+
+    uint64_t hits;                ///< Expert batches served by a resident expert.
+    uint64_t page_ins;            ///< Expert batches that programmed their expert.
+    uint64_t evictions;           ///< Resident experts replaced.
+    std::vector<T> out_buf;       ///< Output of one expert for one token.
+};
+
+#endif // ANALOG_MOE_H
@@ -10,6 +10,41 @@
 #include "analogMatrix.h"
 #include "analogVector.h"
 #include "analogContext.h"
+#include "analogThreadPool.h"
+
+/**
+ * @brief Programs the current device codes of a matrix on a specified tile, without quantizing it.
+ *
+ * transfer_to_device must have been called; mvm_set_matrix and mvm_set_matrices do both.
+ * @param ctx The analog context managing the scales.
+ * @param mat The matrix to set to the tile.
+ * @param tile_id The ID of the tile to set the matrix.
+ * @return The status flag indicating whether the operation was successful or not.
+ */
+template <typename T, typename qT = T>
+uint16_t mvm_program_matrix(AnalogContext &ctx, AnalogMatrix<T, qT> &mat, uint16_t tile_id) {
+    ctx.set_matrix(&mat, tile_id); // Set the matrix scale in the context
+    ctx.set_row_sums(mat.get_row_sums(), tile_id); // Needed to undo unsigned input offsets
+
+    qT* data = mat.get_device_mat(); // Get the pointer to the device matrix data
+    uint16_t status_flag = 0;
+
+    // Identical blocks already on a tile are shared instead of programmed again (deduplication)
+    bool program = true;
+    uint16_t physical_id = static_cast<uint16_t>(
+        ctx.bind_tile(tile_id, data, sizeof(qT) * mat.get_device_rows() * mat.get_device_cols(), program));
+    if (!program) {
+        return status_flag;
+    }
+
+    asm volatile (
+        "mvm.set %0, %1, %2"
+        : "=r" (status_flag)
+        : "r"(data), "r"(physical_id)
+        : "memory"
+    );
+    return status_flag;
+}
 
 /**
  * @brief Sets a matrix to a specified tile.
@@ -21,18 +56,58 @@
 template <typename T, typename qT = T>
 uint16_t mvm_set_matrix(AnalogContext &ctx, AnalogMatrix<T, qT> &mat, uint16_t tile_id) {
     mat.transfer_to_device(); // Transfer the matrix to device (quantize if integral)
-                              //
-    ctx.set_matrix(&mat, tile_id); // Set the matrix scale in the context
+    return mvm_program_matrix(ctx, mat, tile_id);
+}
+
+/**
+ * @brief Sets many matrices to tiles, quantizing them concurrently on a thread pool.
+ *
+ * Every matrix is quantized independently, so the codes do not depend on the number of
+ * threads; the tiles are then programmed in order on the calling thread.
+ * @param ctx The analog context managing the scales.
+ * @param mats The matrices to set.
+ * @param tile_ids The tile of every matrix.
+ * @param count Number of matrices.
+ * @param pool Threads that quantize the matrices.
+ * @return The first non-zero status flag, or 0 if every tile was programmed successfully.
+ */
+template <typename T, typename qT = T>
+uint16_t mvm_set_matrices(AnalogContext &ctx, AnalogMatrix<T, qT>* const* mats, const uint16_t* tile_ids,
+                          uint32_t count, AnalogThreadPool &pool) {
+    pool.parallel_for(0, count, [mats](uint32_t i) { mats[i]->transfer_to_device(); });
+    uint16_t status_flag = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint16_t status = mvm_program_matrix(ctx, *mats[i], tile_ids[i]);
+        if (status_flag == 0) {
+            status_flag = status;
+        }
+    }
+    return status_flag;
+}
 
+/**
+ * @brief Reprograms a tile with the matrix's existing device codes to undo conductance drift.
+ *
+ * Unlike mvm_set_matrix, the matrix is not quantized again and the matrix version is unchanged,
+ * so result caches stay valid; only the programming age of the tile is reset.
+ * @param ctx The analog context managing the scales.
+ * @param mat The matrix currently set on the tile.
+ * @param tile_id The ID of the tile to refresh.
+ * @return The status flag indicating whether the operation was successful or not.
+ */
+template <typename T, typename qT = T>
+uint16_t mvm_refresh_matrix(AnalogContext &ctx, AnalogMatrix<T, qT> &mat, uint16_t tile_id) {
     qT* data = mat.get_device_mat(); // Get the pointer to the device matrix data
+    uint16_t physical_id = static_cast<uint16_t>(ctx.get_physical_tile(tile_id));
     uint16_t status_flag = 0;
 
     asm volatile (
         "mvm.set %0, %1, %2"
         : "=r" (status_flag)
-        : "r"(data), "r"(tile_id)
+        : "r"(data), "r"(physical_id)
         : "memory"
     );
+    ctx.mark_programmed(tile_id);
     return status_flag;
 }
 
@@ -48,14 +123,45 @@ uint16_t mvm_load_vector(AnalogContext &ctx, AnalogVector<T, qT> &vec, uint16_t
     vec.transfer_to_device(); // Transfer the vector to device (quantize if integral)
 
     ctx.set_input_vector(&vec, tile_id);
+    ctx.set_input_offset(vec.get_input_offset(), tile_id);
 
     void* data = vec.get_device_arr(); // Get the pointer to the device vector data
+    uint16_t physical_id = static_cast<uint16_t>(ctx.get_physical_tile(tile_id));
     uint16_t status_flag = 0;
 
     asm volatile (
         "mvm.l %0, %1, %2"
         : "=r" (status_flag)
-        : "r"(data), "r"(tile_id)
+        : "r"(data), "r"(physical_id)
+        : "memory"
+    );
+    return status_flag;
+}
+
+/**
+ * @brief Loads a vector whose device array is already populated into a specified tile.
+ *
+ * Unlike mvm_load_vector, the host array is not re-quantized; the device array and the
+ * scale factor of the vector are used as-is. This lets operators that produce quantized
+ * state directly (e.g. recurrent hidden state) skip the host round trip.
+ * @param ctx The analog context managing the scales.
+ * @param vec The vector to load into the tile.
+ * @param tile_id The ID of the tile to load the vector.
+ * @return The status flag indicating whether the operation was successful or not.
+ */
+template <typename T, typename qT = T>
+uint16_t mvm_load_device_vector(AnalogContext &ctx, AnalogVector<T, qT> &vec, uint16_t tile_id) {
+    ctx.set_input_vector(&vec, tile_id);
+    ctx.set_input_offset(vec.get_input_offset(), tile_id);
+
+    void* data = vec.get_device_arr(); // Get the pointer to the device vector data
+    uint16_t physical_id = static_cast<uint16_t>(ctx.get_physical_tile(tile_id));
+    uint16_t status_flag = 0;
+
+    asm volatile (
+        "mvm.l %0, %1, %2"
+        : "=r" (status_flag)
+        : "r"(data), "r"(physical_id)
         : "memory"
     );
     return status_flag;
@@ -68,12 +174,13 @@ uint16_t mvm_load_vector(AnalogContext &ctx, AnalogVector<T, qT> &vec, uint16_t
  * @return The status flag indicating whether the operation was successful or not.
  */
 uint16_t mvm_compute(AnalogContext &ctx, uint16_t tile_id) {
+    uint16_t physical_id = static_cast<uint16_t>(ctx.get_physical_tile(tile_id));
     uint16_t status_flag = 0;
 
     asm volatile (
         "mvm %0, %1, x0"
         : "=r" (status_flag)
-        : "r"(tile_id)
+        : "r"(physical_id)
     );
 
     auto* mat = ctx.get_matrix(tile_id);
@@ -83,6 +190,26 @@ uint16_t mvm_compute(AnalogContext &ctx, uint16_t tile_id) {
     return status_flag;
 }
 
+/**
+ * @brief Undoes the code offset of an unsigned-encoded input on the raw outputs of a tile.
+ *
+ * The tile computed W (u - offset); adding offset * row_sum(W) yields W u.
+ * @param ctx The analog context managing the scales.
+ * @param data The raw device outputs (DEVICE_ROWS).
+ * @param tile_id The ID of the tile the outputs were stored from.
+ */
+template <typename qT>
+void mvm_correct_input_offset(AnalogContext &ctx, qT* data, uint16_t tile_id) {
+    int64_t offset = ctx.get_input_offset(tile_id);
+    const int64_t* sums = ctx.get_row_sums(tile_id);
+    if (offset == 0 || sums == nullptr) {
+        return;
+    }
+    for (uint16_t i = 0; i < DEVICE_ROWS; i++) {
+        data[i] = static_cast<qT>(data[i] + offset * sums[i]);
+    }
+}
+
 /**
  * @brief Stores a vector from a specified tile.
  * @param ctx The analog context managing the scales.
@@ -93,14 +220,16 @@ uint16_t mvm_compute(AnalogContext &ctx, uint16_t tile_id) {
 template <typename T, typename qT = T>
 uint16_t mvm_store_vector(AnalogContext &ctx, AnalogVector<T, qT> &vec, uint16_t tile_id) {
     qT* data = vec.get_device_arr(); // Get the pointer to the device vector data
+    uint16_t physical_id = static_cast<uint16_t>(ctx.get_physical_tile(tile_id));
     uint16_t status_flag = 0;
 
     asm volatile (
         "mvm.s %0, %1, %2"
         : "=r" (status_flag)
-        : "r"(data), "r"(tile_id)
+        : "r"(data), "r"(physical_id)
         : "memory"
     );
+    mvm_correct_input_offset(ctx, data, tile_id);
 
     auto* input_vector = ctx.get_input_vector(tile_id); // Get the output scale for dequantization
     double scale = input_vector->get_scale_factor();
@@ -108,16 +237,46 @@ uint16_t mvm_store_vector(AnalogContext &ctx, AnalogVector<T, qT> &vec, uint16_t
     return status_flag;
 }
 
+/**
+ * @brief Stores a vector from a specified tile, fusing an elementwise operation into dequantization.
+ * @param ctx The analog context managing the scales.
+ * @param vec The vector to store from the tile.
+ * @param tile_id The ID of the tile to store the vector from.
+ * @param op Callable invoked as op(index, value) on each dequantized element.
+ * @return The status flag indicating whether the operation was successful or not.
+ */
+template <typename T, typename qT, typename Op>
+uint16_t mvm_store_vector(AnalogContext &ctx, AnalogVector<T, qT> &vec, uint16_t tile_id, Op op) {
+    qT* data = vec.get_device_arr(); // Get the pointer to the device vector data
+    uint16_t physical_id = static_cast<uint16_t>(ctx.get_physical_tile(tile_id));
+    uint16_t status_flag = 0;
+
+    asm volatile (
+        "mvm.s %0, %1, %2"
+        : "=r" (status_flag)
+        : "r"(data), "r"(physical_id)
+        : "memory"
+    );
+    mvm_correct_input_offset(ctx, data, tile_id);
+
+    auto* input_vector = ctx.get_input_vector(tile_id); // Get the output scale for dequantization
+    double scale = input_vector->get_scale_factor();
+    vec.transfer_to_host(scale, op); // Dequantize and apply op in a single pass
+    return status_flag;
+}
+
 
 uint32_t mvm_move_vector(AnalogContext &ctx, uint32_t tile_id, uint32_t tile_id_new) {
     uint32_t status_flag;
 
     ctx.move_vector(tile_id, tile_id_new);
+    uint32_t physical_id = ctx.get_physical_tile(tile_id);
+    uint32_t physical_id_new = ctx.get_physical_tile(tile_id_new);
 
     asm volatile (
         "mvm.mv %0, %1, %2"
         : "=r" (status_flag)
-        : "r"(tile_id), "r"(tile_id_new)
+        : "r"(physical_id), "r"(physical_id_new)
     );
 
     return status_flag;
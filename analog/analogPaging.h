@@ -0,0 +1,469 @@
+/**
+ * @file analogPaging.h
+ * @brief This file contains out-of-core paging of quantized device blocks for models larger than host RAM.
+ *
+ * AnalogBlockWriter quantizes weights block by block (the AnalogTiledLinear layout) and stores
+ * the device codes and scales as fixed-size records, so neither the host weights nor the codes
+ * of the whole model have to be resident. AnalogBlockPager reads records back with pread on a
+ * thread pool ahead of use into a bounded staging cache and programs them with mvm_set_matrix.
+ */
+
+#ifndef ANALOG_PAGING_H
+#define ANALOG_PAGING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "analogMatrix.h"
+#include "analogContext.h"
+#include "analogOperations.h"
+#include "analogThreadPool.h"
+
+/**
+ * @struct AnalogBlockFileHeader
+ * @brief Header at the start of a block file.
+ */
+struct AnalogBlockFileHeader {
+    char magic[8];          ///< "ANLGBLK1".
+    uint32_t code_bytes;    ///< sizeof(qT) of the stored codes.
+    uint32_t device_rows;   ///< DEVICE_ROWS the file was written for.
+    uint32_t device_cols;   ///< DEVICE_COLS the file was written for.
+    uint32_t record_bytes;  ///< Size of one block record.
+    uint64_t num_blocks;    ///< Number of records.
+};
+
+/**
+ * @struct AnalogBlockRecordHeader
+ * @brief Header of one block record; the device codes follow it.
+ */
+struct AnalogBlockRecordHeader {
+    uint16_t rows;                    ///< Valid rows of the block.
+    uint16_t cols;                    ///< Valid columns of the block.
+    uint16_t row_scaling;             ///< Whether row_scales holds per-row scales.
+    uint16_t reserved;
+    double scale;                     ///< Dequantization scale of the block.
+    double row_scales[DEVICE_ROWS];   ///< Per-row dequantization scales (row scaling only).
+};
+
+/**
+ * @brief Returns the size of a block record with codes of type qT, padded to 64 bytes.
+ */
+template <typename qT>
+inline uint32_t analog_block_record_bytes() {
+    size_t bytes = sizeof(AnalogBlockRecordHeader) + sizeof(qT) * DEVICE_ROWS * DEVICE_COLS;
+    return static_cast<uint32_t>((bytes + 63) / 64 * 64);
+}
+
+/**
+ * @class AnalogBlockWriter
+ * @brief Appends quantized device blocks to a block file.
+ * @tparam T Host data type.
+ * @tparam qT Device data type of the weights.
+ */
+template <typename T, typename qT = T>
+class AnalogBlockWriter {
+public:
+    /**
+     * @brief Constructor of the AnalogBlockWriter class; creates (or truncates) the file.
+     * @param path Path of the block file.
+     */
+    explicit AnalogBlockWriter(const char* path)
+        : file(std::fopen(path, "wb")),
+          num_blocks(0),
+          record(analog_block_record_bytes<qT>()) {
+        if (!file) {
+            std::cerr << "Error: cannot create block file " << path << ": " << std::strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        write_header();
+    }
+
+    AnalogBlockWriter(const AnalogBlockWriter&) = delete;
+    AnalogBlockWriter& operator=(const AnalogBlockWriter&) = delete;
+
+    ~AnalogBlockWriter() {
+        close();
+    }
+
+    /**
+     * @brief Quantizes a matrix and appends its device block.
+     * @return The index of the block in the file.
+     */
+    uint64_t append(AnalogMatrix<T, qT> &mat) {
+        mat.transfer_to_device();
+        std::fill(record.begin(), record.end(), 0);
+        AnalogBlockRecordHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.rows = mat.get_host_rows();
+        header.cols = mat.get_host_cols();
+        header.row_scaling = mat.has_row_scaling() ? 1 : 0;
+        header.scale = mat.get_scale_factor();
+        for (uint16_t i = 0; i < header.rows; i++) {
+            header.row_scales[i] = mat.get_row_scale(i);
+        }
+        std::memcpy(record.data(), &header, sizeof(header));
+        std::memcpy(record.data() + sizeof(header), mat.get_device_mat(), sizeof(qT) * DEVICE_ROWS * DEVICE_COLS);
+        if (std::fwrite(record.data(), 1, record.size(), file) != record.size()) {
+            std::cerr << "Error: writing block " << num_blocks << " failed: " << std::strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        return num_blocks++;
+    }
+
+    /**
+     * @brief Splits a matrix into tile blocks (row block major, as AnalogTiledLinear) and appends them.
+     * @param weights Row-major weights (rows x cols).
+     * @param rows Number of rows.
+     * @param cols Number of columns.
+     * @param row_scaling Whether to quantize every row of every block with its own scale.
+     * @return The index of the first block.
+     */
+    uint64_t append_matrix(const T* weights, uint32_t rows, uint32_t cols, bool row_scaling = false) {
+        uint64_t first = num_blocks;
+        std::vector<T> block(static_cast<size_t>(DEVICE_ROWS) * DEVICE_COLS);
+        for (uint32_t r0 = 0; r0 < rows; r0 += DEVICE_ROWS) {
+            uint16_t h = static_cast<uint16_t>(rows - r0 < DEVICE_ROWS ? rows - r0 : DEVICE_ROWS);
+            for (uint32_t c0 = 0; c0 < cols; c0 += DEVICE_COLS) {
+                uint16_t w = static_cast<uint16_t>(cols - c0 < DEVICE_COLS ? cols - c0 : DEVICE_COLS);
+                for (uint16_t i = 0; i < h; i++) {
+                    for (uint16_t j = 0; j < w; j++) {
+                        block[i * w + j] = weights[static_cast<size_t>(r0 + i) * cols + c0 + j];
+                    }
+                }
+                AnalogMatrix<T, qT> mat(block.data(), h, w);
+                mat.set_row_scaling(row_scaling);
+                append(mat);
+            }
+        }
+        return first;
+    }
+
+    /**
+     * @brief Writes the final block count and closes the file.
+     */
+    void close() {
+        if (!file) {
+            return;
+        }
+        std::fseek(file, 0, SEEK_SET);
+        write_header();
+        std::fclose(file);
+        file = nullptr;
+    }
+
+    uint64_t get_num_blocks() const {
+        return num_blocks;
+    }
+
+private:
+    void write_header() {
+        AnalogBlockFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "ANLGBLK1", 8);
+        header.code_bytes = sizeof(qT);
+        header.device_rows = DEVICE_ROWS;
+        header.device_cols = DEVICE_COLS;
+        header.record_bytes = analog_block_record_bytes<qT>();
+        header.num_blocks = num_blocks;
+        if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+            std::cerr << "Error: writing block file header failed: " << std::strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    std::FILE* file;              ///< Open block file.
+    uint64_t num_blocks;          ///< Blocks written.
+    std::vector<uint8_t> record;  ///< Record being written.
+};
+
+/**
+ * @class AnalogBlockPager
+ * @brief Programs blocks of a block file onto tiles, reading ahead into a bounded staging cache.
+ *
+ * program(block) starts asynchronous reads of the next readahead blocks before waiting for the
+ * requested one, so sequential streams overlap the file reads with mvm_set_matrix. Records are
+ * read with pread on the given thread pool; cache_blocks bounds the staging memory and should
+ * exceed readahead, otherwise fewer blocks are read ahead (the slot being programmed stays
+ * pinned).
+ * program and prefetch are meant to be called from one streaming thread.
+ * @tparam T Host data type.
+ * @tparam qT Device data type of the weights.
+ */
+template <typename T, typename qT = T>
+class AnalogBlockPager {
+public:
+    /**
+     * @brief Constructor of the AnalogBlockPager class; opens and validates the block file.
+     * @param path Path of the block file.
+     * @param io_pool Threads issuing the reads.
+     * @param cache_blocks Number of staged records kept in memory.
+     * @param readahead Number of blocks read ahead of the one being programmed.
+     */
+    AnalogBlockPager(const char* path, AnalogThreadPool &io_pool, uint32_t cache_blocks, uint32_t readahead)
+        : fd(::open(path, O_RDONLY)),
+          io_pool(io_pool),
+          readahead(readahead),
+          slots(cache_blocks > 0 ? cache_blocks : 1),
+          tick(0),
+          pinned(-1),
+          hits(0),
+          waits(0),
+          misses(0),
+          bytes_read(0) {
+        if (fd < 0) {
+            std::cerr << "Error: cannot open block file " << path << ": " << std::strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        read_exact(&header, sizeof(header), 0);
+        if (std::memcmp(header.magic, "ANLGBLK1", 8) != 0 || header.code_bytes != sizeof(qT) ||
+            header.device_rows != DEVICE_ROWS || header.device_cols != DEVICE_COLS ||
+            header.record_bytes != analog_block_record_bytes<qT>()) {
+            std::cerr << "Error: " << path << " is not a block file for this device and code type." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        for (Slot &slot : slots) {
+            slot.data.resize(header.record_bytes);
+        }
+    }
+
+    AnalogBlockPager(const AnalogBlockPager&) = delete;
+    AnalogBlockPager& operator=(const AnalogBlockPager&) = delete;
+
+    ~AnalogBlockPager() {
+        // Outstanding reads write into the slots; finish them before the buffers go away
+        for (Slot &slot : slots) {
+            if (slot.ready.valid()) {
+                slot.ready.wait();
+            }
+        }
+        ::close(fd);
+    }
+
+    /**
+     * @brief Starts reading a block into the staging cache, if it is not staged or in flight.
+     */
+    void prefetch(uint64_t block) {
+        if (block >= header.num_blocks) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        stage(block);
+    }
+
+    /**
+     * @brief Programs a block on a tile, reading ahead the following blocks.
+     * @param ctx The analog context managing the scales.
+     * @param block Index of the block in the file.
+     * @param tile_id The ID of the tile to program.
+     * @return The status flag of mvm_set_matrix.
+     */
+    uint16_t program(AnalogContext &ctx, uint64_t block, uint16_t tile_id) {
+        if (block >= header.num_blocks) {
+            std::cerr << "Error: block " << block << " is out of range (" << header.num_blocks << " blocks)." << std::endl;
+            return 0;
+        }
+        if (tile_mats.size() < ctx.get_num_arrays()) {
+            tile_mats.resize(ctx.get_num_arrays());
+        }
+
+        std::vector<uint8_t> fallback;
+        const uint8_t* record = nullptr;
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = index.find(block);
+        if (it == index.end()) {
+            misses++;
+        } else if (slots[it->second].ready.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            hits++;
+        } else {
+            waits++;
+        }
+        int s = it == index.end() ? stage(block) : static_cast<int>(it->second);
+        if (s >= 0) {
+            // Keep the read-ahead below (and concurrent prefetches) from recycling it until it is programmed
+            slots[s].last_use = ++tick;
+            pinned = s;
+        }
+        for (uint64_t b = block + 1; b <= block + readahead && b < header.num_blocks; b++) {
+            stage(b);
+        }
+        if (s < 0) {
+            // Every slot is still loading: read synchronously
+            lock.unlock();
+            fallback.resize(header.record_bytes);
+            read_record(fallback.data(), block);
+            record = fallback.data();
+            lock.lock();
+        } else {
+            std::shared_future<void> ready = slots[s].ready;
+            lock.unlock();
+            ready.wait();
+            lock.lock();
+            record = slots[s].data.data();
+            slots[s].consumed = true;
+        }
+
+        // The slot cannot be recycled while the lock is held
+        AnalogBlockRecordHeader rec;
+        std::memcpy(&rec, record, sizeof(rec));
+        std::unique_ptr<AnalogMatrix<T, qT>> mat(new AnalogMatrix<T, qT>(rec.rows, rec.cols));
+        mat->set_device_mat(reinterpret_cast<const qT*>(record + sizeof(rec)), rec.scale,
+                            rec.row_scaling ? rec.row_scales : nullptr);
+        pinned = -1;
+        lock.unlock();
+
+        uint16_t status_flag = mvm_set_matrix(ctx, *mat, tile_id);
+        tile_mats[tile_id] = std::move(mat);
+        return status_flag;
+    }
+
+    /**
+     * @brief Returns the matrix last programmed on a tile by this pager (for row scales and scale).
+     */
+    AnalogMatrix<T, qT>& get_matrix(uint16_t tile_id) {
+        return *tile_mats[tile_id];
+    }
+
+    uint64_t get_num_blocks() const { return header.num_blocks; }
+    uint32_t get_record_bytes() const { return header.record_bytes; }
+
+    /**
+     * @brief Returns the requests whose block was already staged.
+     */
+    uint64_t get_hits() const { return hits; }
+
+    /**
+     * @brief Returns the requests whose block was still being read.
+     */
+    uint64_t get_waits() const { return waits; }
+
+    /**
+     * @brief Returns the requests whose block had not been requested before.
+     */
+    uint64_t get_misses() const { return misses; }
+
+    uint64_t get_bytes_read() const { return bytes_read; }
+
+    void reset_counters() {
+        hits = 0;
+        waits = 0;
+        misses = 0;
+        bytes_read = 0;
+    }
+
+private:
+    struct Slot {
+        Slot() : block(0), valid(false), consumed(false), last_use(0) {}
+
+        uint64_t block;                  ///< Block staged in the slot.
+        bool valid;                      ///< Whether the slot holds (or is reading) a block.
+        bool consumed;                   ///< Whether the block was programmed since it was read.
+        uint64_t last_use;               ///< LRU stamp.
+        std::shared_future<void> ready;  ///< Completes when the read finished.
+        std::vector<uint8_t> data;       ///< Record buffer.
+    };
+
+    /**
+     * @brief Claims a slot for a block and starts its read; mutex must be held.
+     *
+     * Free slots are used first, then the least recently used programmed block, then the least
+     * recently staged block that was read ahead. The slot being programmed is never recycled.
+     * @return The slot, or -1 if the block is not staged and every slot is still loading.
+     */
+    int stage(uint64_t block) {
+        auto it = index.find(block);
+        if (it != index.end()) {
+            return static_cast<int>(it->second);
+        }
+        int victim = -1;
+        for (size_t i = 0; i < slots.size(); i++) {
+            Slot &slot = slots[i];
+            bool busy = slot.valid && slot.ready.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+            if (busy || static_cast<int>(i) == pinned) {
+                continue;
+            }
+            if (!slot.valid) {
+                victim = static_cast<int>(i);
+                break;
+            }
+            // Blocks read ahead but not programmed yet are recycled last
+            if (victim < 0 || slot.consumed > slots[victim].consumed ||
+                (slot.consumed == slots[victim].consumed && slot.last_use < slots[victim].last_use)) {
+                victim = static_cast<int>(i);
+            }
+        }
+        if (victim < 0) {
+            return -1;
+        }
+        Slot &slot = slots[victim];
+        if (slot.valid) {
+            index.erase(slot.block);
+        }
+        slot.block = block;
+        slot.valid = true;
+        slot.consumed = false;
+        slot.last_use = ++tick;
+        uint8_t* dst = slot.data.data();
+        slot.ready = io_pool.submit([this, dst, block] { read_record(dst, block); }).share();
+        index[block] = static_cast<uint32_t>(victim);
+        return victim;
+    }
+
+    void read_record(uint8_t* dst, uint64_t block) {
+        read_exact(dst, header.record_bytes,
+                   static_cast<off_t>(sizeof(AnalogBlockFileHeader) + block * header.record_bytes));
+    }
+
+    void read_exact(void* dst, size_t bytes, off_t offset) {
+        uint8_t* p = static_cast<uint8_t*>(dst);
+        while (bytes > 0) {
+            ssize_t n = ::pread(fd, p, bytes, offset);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                std::cerr << "Error: reading block file at offset " << offset << " failed: "
+                          << (n < 0 ? std::strerror(errno) : "unexpected end of file") << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            p += n;
+            bytes -= static_cast<size_t>(n);
+            offset += n;
+            bytes_read += static_cast<uint64_t>(n);
+        }
+    }
+
+    int fd;                              ///< Block file.
+    AnalogBlockFileHeader header;        ///< Header of the block file.
+    AnalogThreadPool &io_pool;           ///< Threads issuing the reads.
+    uint32_t readahead;                  ///< Blocks read ahead of the requested one.
+
+    std::vector<Slot> slots;                       ///< Staging cache.
+    std::unordered_map<uint64_t, uint32_t> index;  ///< Block to slot.
+    uint64_t tick;                                 ///< LRU clock.
+    int pinned;                                    ///< Slot program is reading from (-1 if none).
+    std::mutex mutex;                              ///< Guards slots and index.
+
+    std::vector<std::unique_ptr<AnalogMatrix<T, qT>>> tile_mats; ///< Matrix programmed on every tile.
+
+    uint64_t hits;                       ///< Requests served from a finished read.
+    uint64_t waits;                      ///< Requests that waited for an outstanding read.
+    uint64_t misses;                     ///< Requests not read ahead.
+    std::atomic<uint64_t> bytes_read;    ///< Bytes read from the file.
+};
+
+#endif // ANALOG_PAGING_H
@@ -0,0 +1,226 @@
+/**
+ * @file analogPrefetch.h
+ * @brief This file contains a lookahead executor that streams a layer schedule through a window of tiles.
+ *
+ * The tile window is split into two banks. While layer k computes on one bank, a pool thread
+ * quantizes layer k+1 and programs it on the other bank, so for models with more layers than
+ * tiles the programming time is hidden behind the compute of the previous layer.
+ */
+
+#ifndef ANALOG_PREFETCH_H
+#define ANALOG_PREFETCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "analogContext.h"
+#include "analogTiled.h"
+#include "analogThreadPool.h"
+
+/**
+ * @class AnalogPrefetchExecutor
+ * @brief Runs a chain of fully connected layers, programming each layer one step ahead of its use.
+ * @tparam T Host data type.
+ * @tparam qT Device data type of weights and inputs.
+ * @tparam oT Device data type of the outputs.
+ */
+template <typename T, typename qT = T, typename oT = qT>
+class AnalogPrefetchExecutor {
+public:
+    /**
+     * @brief Constructor of the AnalogPrefetchExecutor class.
+     * @param ctx The analog context managing the scales.
+     * @param pool Threads that quantize and program the next layer.
+     * @param first_tile The ID of the first tile of the window.
+     * @param num_tiles Size of the window; each bank holds num_tiles / 2 tiles.
+     */
+    AnalogPrefetchExecutor(AnalogContext &ctx, AnalogThreadPool &pool, uint16_t first_tile, uint32_t num_tiles)
+        : ctx(ctx),
+          pool(pool),
+          first_tile(first_tile),
+          bank_tiles(num_tiles / 2),
+          prefetch(true),
+          programs(0),
+          program_seconds(0.0),
+          stall_seconds(0.0) {
+        if (bank_tiles == 0 || first_tile + num_tiles > ctx.get_num_arrays()) {
+            std::cerr << "Error: prefetch window of " << num_tiles << " tiles from tile " << first_tile
+                      << " does not fit a context of " << ctx.get_num_arrays() << " tiles." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        bank_layer[0] = bank_layer[1] = NONE;
+    }
+
+    AnalogPrefetchExecutor(const AnalogPrefetchExecutor&) = delete;
+    AnalogPrefetchExecutor& operator=(const AnalogPrefetchExecutor&) = delete;
+
+    /**
+     * @brief Appends a layer to the schedule.
+     * @param weights Row-major weights (rows x cols); referenced, must outlive the executor.
+     * @param rows Number of output rows.
+     * @param cols Number of input columns; must equal the rows of the previous layer.
+     * @param activation Optional element-wise function applied to the layer's output.
+     * @return The index of the layer in the schedule.
+     */
+    uint32_t add_layer(T* weights, uint32_t rows, uint32_t cols, std::function<T(T)> activation = nullptr) {
+        if (!schedule.empty() && schedule.back().rows != cols) {
+            std::cerr << "Error: layer " << schedule.size() << " takes " << cols << " inputs but the previous layer has "
+                      << schedule.back().rows << " outputs." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        if (AnalogTiledLinear<T, qT, oT>::count_tiles(rows, cols) > bank_tiles) {
+            std::cerr << "Error: layer " << schedule.size() << " needs "
+                      << AnalogTiledLinear<T, qT, oT>::count_tiles(rows, cols) << " tiles but a bank has "
+                      << bank_tiles << "." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        schedule.push_back(Stage{weights, rows, cols, std::move(activation)});
+        if (cols > buf[0].size()) {
+            buf[0].resize(cols);
+        }
+        for (int b = 0; b < 2; b++) {
+            if (rows > buf[b].size()) {
+                buf[b].resize(rows);
+            }
+        }
+        return static_cast<uint32_t>(schedule.size() - 1);
+    }
+
+    /**
+     * @brief Runs the schedule on one input.
+     *
+     * Layers still resident from the previous call are not programmed again.
+     * @param x Input vector (cols of the first layer).
+     * @param y Output vector (rows of the last layer).
+     */
+    void forward(const T* x, T* y) {
+        uint32_t n = static_cast<uint32_t>(schedule.size());
+        if (n == 0) {
+            return;
+        }
+        for (uint32_t j = 0; j < schedule[0].cols; j++) {
+            buf[0][j] = x[j];
+        }
+
+        std::future<void> next = program(0);
+        int cur = 0;
+        for (uint32_t k = 0; k < n; k++) {
+            auto start = std::chrono::steady_clock::now();
+            next.get();
+            stall_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (k + 1 < n) {
+                next = program(k + 1);
+            }
+
+            const Stage &stage = schedule[k];
+            AnalogTiledLinear<T, qT, oT> &layer = *layers[k % 2];
+            T* in = buf[cur].data();
+            T* out = k + 1 < n ? buf[1 - cur].data() : y;
+            if (stage.activation) {
+                layer.forward(in, out, [&stage](uint32_t, T v) { return stage.activation(v); });
+            } else {
+                layer.forward(in, out);
+            }
+            cur = 1 - cur;
+        }
+    }
+
+    /**
+     * @brief Enables or disables lookahead; when disabled every layer is programmed right before it runs.
+     */
+    void set_prefetch(bool enabled) {
+        prefetch = enabled;
+    }
+
+    uint32_t get_num_layers() const {
+        return static_cast<uint32_t>(schedule.size());
+    }
+
+    /**
+     * @brief Returns the number of layer programmings (quantize and mvm_set_matrix of every block).
+     */
+    uint64_t get_programs() const { return programs; }
+
+    /**
+     * @brief Returns the total seconds spent quantizing and programming layers.
+     */
+    double get_program_seconds() const { return program_seconds; }
+
+    /**
+     * @brief Returns the seconds forward waited for a layer to finish programming (the unhidden part).
+     */
+    double get_stall_seconds() const { return stall_seconds; }
+
+    void reset_counters() {
+        programs = 0;
+        program_seconds = 0.0;
+        stall_seconds = 0.0;
+    }
+
+private:
+    static const uint32_t NONE = 0xFFFFFFFFu;
+
+    struct Stage {
+        T* weights;                     ///< Row-major weights (referenced).
+        uint32_t rows;                  ///< Number of output rows.
+        uint32_t cols;                  ///< Number of input columns.
+        std::function<T(T)> activation; ///< Optional element-wise epilogue.
+    };
+
+    /**
+     * @brief Programs layer k on bank k % 2, on a pool thread when prefetching.
+     *
+     * The bank's previous layer (k - 2) has finished by the time this is called.
+     */
+    std::future<void> program(uint32_t k) {
+        int bank = k % 2;
+        if (bank_layer[bank] == k) {
+            std::promise<void> ready;
+            ready.set_value();
+            return ready.get_future();
+        }
+        bank_layer[bank] = k;
+        auto task = [this, k, bank]() {
+            auto start = std::chrono::steady_clock::now();
+            const Stage &stage = schedule[k];
+            layers[bank].reset();
+            layers[bank].reset(new AnalogTiledLinear<T, qT, oT>(
+                ctx, stage.weights, stage.rows, stage.cols, static_cast<uint16_t>(first_tile + bank * bank_tiles)));
+            program_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            programs++;
+        };
+        if (prefetch) {
+            return pool.submit(task);
+        }
+        // Without lookahead the whole programming time is a stall
+        auto start = std::chrono::steady_clock::now();
+        std::packaged_task<void()> inline_task(task);
+        std::future<void> done = inline_task.get_future();
+        inline_task();
+        stall_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return done;
+    }
+
+    AnalogContext &ctx;        ///< Context the layers are programmed in.
+    AnalogThreadPool &pool;    ///< Threads that program the next layer.
+    uint16_t first_tile;       ///< First tile of the window.
+    uint32_t bank_tiles;       ///< Tiles per bank.
+    bool prefetch;             ///< Whether the next layer is programmed during the current one.
+
+    std::vector<Stage> schedule;                              ///< Layers in execution order.
+    std::unique_ptr<AnalogTiledLinear<T, qT, oT>> layers[2];  ///< Layer programmed on each bank.
+    uint32_t bank_layer[2];                                   ///< Schedule index on each bank (NONE if empty).
+    std::vector<T> buf[2];                                    ///< Ping-pong activations.
+
+    uint64_t programs;         ///< Layer programmings.
+    double program_seconds;    ///< Time spent programming.
+    double stall_seconds;      ///< Time forward waited on programming.
+};
+
+#endif // ANALOG_PREFETCH_H
@@ -0,0 +1,365 @@
+/**
+ * @file analogQoS.h
+ * @brief This file contains a multi-tenant scheduler that shares the tiles between tenants with priorities.
+ *
+ * A job is a sequence of operations, each of which runs without interruption (e.g. one
+ * load/compute/store on a tile, or one row block of a tiled layer). The dispatcher picks the
+ * next operation after every operation: the highest priority with queued work wins, and tenants
+ * of equal priority share the device in proportion to their weights (start-time fair queuing on
+ * measured operation time). A latency-critical job therefore waits for at most one operation of
+ * a batch job instead of the whole job. Every priority level keeps a system virtual time, the
+ * start tag of its last dispatched operation; a tenant that becomes busy (new or back from idle)
+ * starts no earlier than it, so idle time neither banks credit nor costs a penalty.
+ */
+
+#ifndef ANALOG_QOS_H
+#define ANALOG_QOS_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "analogVector.h"
+#include "analogContext.h"
+#include "analogOperations.h"
+#include "analogTiled.h"
+
+/**
+ * @class AnalogQoSScheduler
+ * @brief Dispatches the operations of per-tenant job queues by priority and weighted fair share.
+ */
+class AnalogQoSScheduler {
+public:
+    /**
+     * @brief Constructor of the AnalogQoSScheduler class.
+     * @param ctx The analog context the operations run in.
+     * @param latency_window Number of most recent job latencies kept per tenant for percentiles.
+     */
+    explicit AnalogQoSScheduler(AnalogContext &ctx, uint32_t latency_window = 4096)
+        : ctx(ctx),
+          latency_window(latency_window > 0 ? latency_window : 1),
+          last_tenant(-1),
+          stopping(false) {}
+
+    AnalogQoSScheduler(const AnalogQoSScheduler&) = delete;
+    AnalogQoSScheduler& operator=(const AnalogQoSScheduler&) = delete;
+
+    ~AnalogQoSScheduler() {
+        stop();
+    }
+
+    /**
+     * @brief Registers a tenant.
+     * @param priority Higher priorities always run first.
+     * @param weight Share of the device relative to tenants of the same priority.
+     * @return The tenant ID.
+     */
+    uint32_t add_tenant(uint32_t priority, double weight = 1.0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        tenants.emplace_back(new Tenant(priority, weight > 0.0 ? weight : 1.0));
+        return static_cast<uint32_t>(tenants.size() - 1);
+    }
+
+    /**
+     * @brief Queues a job for a tenant.
+     * @param tenant The tenant ID.
+     * @param ops Operations run in order; the scheduler may switch tenants between them.
+     * @return Completes when the last operation has run.
+     */
+    std::future<void> submit(uint32_t tenant, std::vector<std::function<void()>> ops) {
+        std::unique_ptr<Job> job(new Job());
+        job->ops = std::move(ops);
+        if (job->ops.empty()) {
+            job->ops.push_back([] {});
+        }
+        job->submitted = std::chrono::steady_clock::now();
+        std::future<void> done = job->done.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!find_tenant(tenant)) {
+                job->done.set_value();
+                return done;
+            }
+            Tenant &t = *tenants[tenant];
+            if (t.queue.empty()) {
+                // A tenant becoming busy starts at the current virtual time of its level
+                t.vtime = std::max(t.vtime, system_vtime[t.priority]);
+            }
+            t.queue.push_back(std::move(job));
+        }
+        cv.notify_one();
+        return done;
+    }
+
+    /**
+     * @brief Queues one matrix-vector product on a tile as a single operation.
+     */
+    template <typename T, typename qT, typename oT>
+    std::future<void> submit_mvm(uint32_t tenant, AnalogVector<T, qT> &in, AnalogVector<T, oT> &out, uint16_t tile_id) {
+        AnalogContext* context = &ctx;
+        std::vector<std::function<void()>> ops;
+        ops.push_back([context, &in, &out, tile_id] {
+            mvm_load_vector(*context, in, tile_id);
+            mvm_compute(*context, tile_id);
+            mvm_store_vector(*context, out, tile_id);
+        });
+        return submit(tenant, std::move(ops));
+    }
+
+    /**
+     * @brief Queues y = W x on a tiled layer with one operation per row block.
+     * @param tenant The tenant ID.
+     * @param layer The layer; must not be used by another job until this one completes.
+     * @param x Input vector (cols); must stay valid until the job completes.
+     * @param y Output vector (rows).
+     */
+    template <typename T, typename qT, typename oT>
+    std::future<void> submit_forward(uint32_t tenant, AnalogTiledLinear<T, qT, oT> &layer, T* x, T* y) {
+        std::vector<std::function<void()>> ops;
+        ops.push_back([&layer, x] { layer.quantize_input(x); });
+        for (uint32_t rb = 0; rb < layer.get_row_blocks(); rb++) {
+            ops.push_back([&layer, y, rb] { layer.forward_rows_analog(rb, rb + 1, y); });
+        }
+        return submit(tenant, std::move(ops));
+    }
+
+    /**
+     * @brief Runs the next operation on the calling thread (instead of, or alongside, start).
+     * @return Whether an operation was run.
+     */
+    bool run_next() {
+        std::unique_lock<std::mutex> lock(mutex);
+        return dispatch(lock);
+    }
+
+    /**
+     * @brief Starts the dispatcher thread.
+     */
+    void start() {
+        stop();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = false;
+        }
+        worker = std::thread([this] {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!stopping) {
+                if (!dispatch(lock)) {
+                    cv.wait(lock);
+                }
+            }
+        });
+    }
+
+    /**
+     * @brief Stops the dispatcher thread after the running operation; queued jobs stay queued.
+     */
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    uint32_t get_num_tenants() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return static_cast<uint32_t>(tenants.size());
+    }
+
+    /**
+     * @brief Returns the number of jobs a tenant has queued or running.
+     */
+    uint32_t get_queue_length(uint32_t tenant) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const Tenant* t = find_tenant(tenant);
+        return t ? static_cast<uint32_t>(t->queue.size()) : 0;
+    }
+
+    uint64_t get_completed(uint32_t tenant) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const Tenant* t = find_tenant(tenant);
+        return t ? t->completed : 0;
+    }
+
+    /**
+     * @brief Returns the seconds of device time a tenant's operations used.
+     */
+    double get_busy_seconds(uint32_t tenant) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const Tenant* t = find_tenant(tenant);
+        return t ? t->busy : 0.0;
+    }
+
+    /**
+     * @brief Returns how often a running job of the tenant was preempted by another tenant.
+     */
+    uint64_t get_preemptions(uint32_t tenant) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const Tenant* t = find_tenant(tenant);
+        return t ? t->preemptions : 0;
+    }
+
+    /**
+     * @brief Returns a percentile (0-100) of the submit-to-completion latency in seconds over the recent window.
+     */
+    double get_latency_percentile(uint32_t tenant, double percentile) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const Tenant* t = find_tenant(tenant);
+        if (!t || t->latencies.empty()) {
+            return 0.0;
+        }
+        std::vector<double> sorted = t->latencies;
+        std::sort(sorted.begin(), sorted.end());
+        double rank = percentile / 100.0 * (sorted.size() - 1);
+        size_t idx = static_cast<size_t>(rank + 0.5);
+        return sorted[std::min(idx, sorted.size() - 1)];
+    }
+
+    /**
+     * @brief Returns the mean submit-to-completion latency in seconds over the recent window.
+     */
+    double get_mean_latency(uint32_t tenant) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const Tenant* t = find_tenant(tenant);
+        if (!t) {
+            return 0.0;
+        }
+        const std::vector<double> &l = t->latencies;
+        double sum = 0.0;
+        for (double v : l) {
+            sum += v;
+        }
+        return l.empty() ? 0.0 : sum / l.size();
+    }
+
+    void reset_counters() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &t : tenants) {
+            t->completed = 0;
+            t->busy = 0.0;
+            t->preemptions = 0;
+            t->latencies.clear();
+            t->latency_pos = 0;
+        }
+    }
+
+private:
+    struct Job {
+        Job() : next(0) {}
+
+        std::vector<std::function<void()>> ops;  ///< Operations in order.
+        size_t next;                             ///< Next operation to run.
+        std::promise<void> done;                 ///< Completed after the last operation.
+        std::chrono::steady_clock::time_point submitted; ///< Submission time.
+    };
+
+    struct Tenant {
+        Tenant(uint32_t priority, double weight)
+            : priority(priority), weight(weight), vtime(0.0), running(false), completed(0), busy(0.0),
+              preemptions(0), latency_pos(0) {}
+
+        uint32_t priority;                        ///< Strict priority level.
+        double weight;                            ///< Fair-share weight within the level.
+        double vtime;                             ///< Device time used divided by weight.
+        bool running;                             ///< Whether an operation of the tenant is running.
+        std::deque<std::unique_ptr<Job>> queue;   ///< Jobs, the running one first.
+        uint64_t completed;                       ///< Jobs finished.
+        double busy;                              ///< Device seconds used.
+        uint64_t preemptions;                     ///< Times a running job was passed over.
+        std::vector<double> latencies;            ///< Recent job latencies (ring).
+        size_t latency_pos;                       ///< Next ring position once full.
+    };
+
+    /**
+     * @brief Returns a tenant, or nullptr after reporting an unknown ID; mutex must be held.
+     */
+    Tenant* find_tenant(uint32_t tenant) const {
+        if (tenant >= tenants.size()) {
+            std::cerr << "Error: unknown tenant " << tenant << "." << std::endl;
+            return nullptr;
+        }
+        return tenants[tenant].get();
+    }
+
+    /**
+     * @brief Picks and runs one operation, releasing the lock while it runs; mutex must be held.
+     */
+    bool dispatch(std::unique_lock<std::mutex> &lock) {
+        int pick = -1;
+        for (size_t i = 0; i < tenants.size(); i++) {
+            const Tenant &t = *tenants[i];
+            if (t.queue.empty() || t.running) {
+                continue;
+            }
+            if (pick < 0 || t.priority > tenants[pick]->priority ||
+                (t.priority == tenants[pick]->priority && t.vtime < tenants[pick]->vtime)) {
+                pick = static_cast<int>(i);
+            }
+        }
+        if (pick < 0) {
+            return false;
+        }
+        if (last_tenant >= 0 && last_tenant != pick && !tenants[last_tenant]->queue.empty() &&
+            tenants[last_tenant]->queue.front()->next > 0) {
+            tenants[last_tenant]->preemptions++;
+        }
+        last_tenant = pick;
+
+        Tenant &t = *tenants[pick];
+        system_vtime[t.priority] = t.vtime;
+        Job* job = t.queue.front().get();
+        std::function<void()> &op = job->ops[job->next];
+        t.running = true;
+        lock.unlock();
+        auto start = std::chrono::steady_clock::now();
+        op();
+        auto end = std::chrono::steady_clock::now();
+        lock.lock();
+        t.running = false;
+
+        double cost = std::chrono::duration<double>(end - start).count();
+        t.busy += cost;
+        t.vtime += cost / t.weight;
+        job->next++;
+        if (job->next >= job->ops.size()) {
+            double latency = std::chrono::duration<double>(end - job->submitted).count();
+            if (t.latencies.size() < latency_window) {
+                t.latencies.push_back(latency);
+            } else {
+                t.latencies[t.latency_pos] = latency;
+                t.latency_pos = (t.latency_pos + 1) % latency_window;
+            }
+            t.completed++;
+            job->done.set_value();
+            t.queue.pop_front();
+        }
+        return true;
+    }
+
+    AnalogContext &ctx;                          ///< Context the operations run in.
+    uint32_t latency_window;                     ///< Latencies kept per tenant.
+    std::vector<std::unique_ptr<Tenant>> tenants; ///< Registered tenants.
+    int last_tenant;                             ///< Tenant of the last operation.
+    std::map<uint32_t, double> system_vtime;     ///< Start tag of the last dispatched operation per priority.
+
+    std::mutex mutex;                            ///< Guards the tenants.
+    std::condition_variable cv;                  ///< Wakes the dispatcher on submit or stop.
+    std::thread worker;                          ///< Dispatcher thread.
+    bool stopping;                               ///< Whether the dispatcher should exit.
+};
+
+#endif // ANALOG_QOS_H
@@ -0,0 +1,359 @@
+/**
+ * @file analogRecurrent.h
+ * @brief This file contains LSTM and GRU cells that keep their weights resident on analog tiles.
+ */
+
+#ifndef ANALOG_RECURRENT_H
+#define ANALOG_RECURRENT_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include <exception>  // For std::bad_alloc
+
+#include "analogContext.h"
+#include "analogTiled.h"
+#include "analogActivation.h"
+
+/**
+ * @class AnalogRecurrentCell
+ * @brief Common state of a recurrent cell whose input and recurrent weights are programmed once.
+ *
+ * The input weights W_ih (gates*hidden x input) and recurrent weights W_hh (gates*hidden x hidden)
+ * are programmed at construction as two AnalogTiledLinear layers, so the hidden size is not
+ * limited to one tile. Each timestep then only loads vectors, and the gate nonlinearities are
+ * fused into the accumulation of the recurrent projection.
+ *
+ * The hidden state is bounded to [-1, 1] by the gate nonlinearities, so it stays on the device
+ * side: every new hidden element is written as a code with the fixed scale 1 / qmax straight
+ * into the input segments of the recurrent layer, which loads them without a host round trip
+ * or a per-step absmax scan. A host copy is kept only for the elementwise state updates.
+ * @tparam T Host data type (float, double).
+ * @tparam qT Device data type of weights and inputs.
+ * @tparam oT Device data type of the tile outputs.
+ */
+template <typename T, typename qT = T, typename oT = qT>
+class AnalogRecurrentCell {
+public:
+    /**
+     * @brief Constructor of the AnalogRecurrentCell class.
+     * @param ctx The analog context managing the scales.
+     * @param gates Number of gates stacked row-wise in the weight matrices.
+     * @param w_ih Row-major input weights (gates*hidden_size x input_size).
+     * @param w_hh Row-major recurrent weights (gates*hidden_size x hidden_size).
+     * @param b_ih Input bias (gates*hidden_size), may be nullptr.
+     * @param b_hh Recurrent bias (gates*hidden_size), may be nullptr.
+     * @param input_size Length of the input vector.
+     * @param hidden_size Length of the hidden state.
+     * @param tile_ih The ID of the first tile of the input weights
+     *                (AnalogTiledLinear::count_tiles(gates * hidden_size, input_size) tiles).
+     * @param tile_hh The ID of the first tile of the recurrent weights
+     *                (AnalogTiledLinear::count_tiles(gates * hidden_size, hidden_size) tiles).
+     */
+    AnalogRecurrentCell(AnalogContext &ctx, uint16_t gates,
+                        T* w_ih, T* w_hh, T* b_ih, T* b_hh,
+                        uint16_t input_size, uint16_t hidden_size,
+                        uint16_t tile_ih, uint16_t tile_hh)
+        : input_size(input_size),
+          hidden_size(hidden_size),
+          gates(gates),
+          lin_ih(ctx, w_ih, static_cast<uint32_t>(gates) * hidden_size, input_size,
+                 check_tiles(gates, input_size, hidden_size, tile_ih, tile_hh)),
+          lin_hh(ctx, w_hh, static_cast<uint32_t>(gates) * hidden_size, hidden_size, tile_hh),
+          hidden(hidden_size),
+          hidden_scale(1.0 / code_max()),
+          gates_ih(static_cast<size_t>(gates) * hidden_size),
+          gates_hh(static_cast<size_t>(gates) * hidden_size),
+          bias(nullptr),
+          bias_hh(nullptr),
+          sigmoid_lut(make_sigmoid_lut<T>()),
+          tanh_lut(make_tanh_lut<T>()) {
+        static_assert(std::is_floating_point<T>::value, "AnalogRecurrentCell requires floating-point host type");
+
+        uint32_t gate_rows = static_cast<uint32_t>(gates) * hidden_size;
+        try {
+            bias = new T[gate_rows]();
+            bias_hh = new T[gate_rows]();
+        } catch (const std::bad_alloc&) {
+            std::cerr << "Memory allocation failed for recurrent bias" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        // Biases are folded into the fused gate epilogue; keep b_hh separately for gates
+        // (GRU candidate) that scale the recurrent term before adding it.
+        for (uint32_t i = 0; i < gate_rows; i++) {
+            T bi = b_ih ? b_ih[i] : static_cast<T>(0);
+            T bh = b_hh ? b_hh[i] : static_cast<T>(0);
+            bias[i] = bi + bh;
+            bias_hh[i] = bh;
+        }
+
+        reset_state();
+    }
+
+    virtual ~AnalogRecurrentCell() {
+        delete[] bias;
+        delete[] bias_hh;
+    }
+
+    AnalogRecurrentCell(const AnalogRecurrentCell&) = delete;
+    AnalogRecurrentCell& operator=(const AnalogRecurrentCell&) = delete;
+
+    /**
+     * @brief Advances the cell by one timestep.
+     * @param x Input vector of length input_size.
+     * @param h_out Optional output for the new hidden state (hidden_size), may be nullptr.
+     */
+    virtual void step(T* x, T* h_out) = 0;
+
+    /**
+     * @brief Runs the cell over a whole sequence.
+     * @param xs Row-major inputs (seq_len x input_size).
+     * @param seq_len Number of timesteps.
+     * @param hs Optional row-major hidden states (seq_len x hidden_size), may be nullptr.
+     */
+    void forward(T* xs, uint32_t seq_len, T* hs) {
+        for (uint32_t t = 0; t < seq_len; t++) {
+            step(xs + t * input_size, hs ? hs + t * hidden_size : nullptr);
+        }
+    }
+
+    /**
+     * @brief Resets the hidden state (and any cell state) to zero.
+     */
+    virtual void reset_state() {
+        for (uint32_t j = 0; j < hidden_size; j++) {
+            write_hidden(j, static_cast<T>(0));
+        }
+    }
+
+    /**
+     * @brief Returns the number of tiles a cell uses from tile_ih and from tile_hh together.
+     */
+    static uint32_t count_tiles(uint16_t gates, uint16_t input_size, uint16_t hidden_size) {
+        uint32_t gate_rows = static_cast<uint32_t>(gates) * hidden_size;
+        return AnalogTiledLinear<T, qT, oT>::count_tiles(gate_rows, input_size) +
+               AnalogTiledLinear<T, qT, oT>::count_tiles(gate_rows, hidden_size);
+    }
+
+protected:
+    /**
+     * @brief Writes one element of the next hidden state, and its code into the recurrent input.
+     * @param j Index of the hidden element.
+     * @param value Hidden value in [-1, 1].
+     */
+    void write_hidden(uint32_t j, T value) {
+        hidden[j] = value;
+        qT* codes = lin_hh.get_segment_codes(j / DEVICE_COLS);
+        if (std::numeric_limits<qT>::is_integer) {
+            double v = value > static_cast<T>(1) ? 1.0 : (value < static_cast<T>(-1) ? -1.0 : value);
+            codes[j % DEVICE_COLS] = static_cast<qT>(std::llround(v * code_max()));
+        } else {
+            codes[j % DEVICE_COLS] = static_cast<qT>(value);
+        }
+    }
+
+    /**
+     * @brief Reads one element of the current hidden state.
+     * @param j Index of the hidden element.
+     */
+    T read_hidden(uint32_t j) const {
+        return hidden[j];
+    }
+
+    /**
+     * @brief Computes W_ih x on the input tiles into gates_ih.
+     * @param x Input vector of length input_size.
+     */
+    void project_input(T* x) {
+        lin_ih.forward(x, gates_ih.data());
+    }
+
+    /**
+     * @brief Computes W_hh h on the recurrent tiles into gates_hh, fusing the gate nonlinearities.
+     *
+     * The hidden codes written by write_hidden are loaded as they are.
+     * @param op Callable invoked as op(index, value) on each recurrent pre-activation, in index order.
+     */
+    template <typename Op>
+    void project_hidden(Op op) {
+        lin_hh.set_device_input(hidden_scale);
+        lin_hh.forward_rows_analog(0, lin_hh.get_row_blocks(), gates_hh.data(), op);
+    }
+
+    uint16_t input_size;            ///< Length of the input vector.
+    uint16_t hidden_size;           ///< Length of the hidden state.
+    uint16_t gates;                 ///< Number of stacked gates.
+
+    AnalogTiledLinear<T, qT, oT> lin_ih; ///< Input weights.
+    AnalogTiledLinear<T, qT, oT> lin_hh; ///< Recurrent weights.
+    std::vector<T> hidden;          ///< Host copy of the hidden state.
+    double hidden_scale;            ///< Fixed scale of the hidden codes (1 / qmax).
+    std::vector<T> gates_ih;        ///< Input projection.
+    std::vector<T> gates_hh;        ///< Gate activations after the fused recurrent projection.
+
+    T* bias;                        ///< Combined b_ih + b_hh.
+    T* bias_hh;                     ///< Recurrent bias alone.
+
+    AnalogLUT<T> sigmoid_lut;       ///< Sigmoid lookup table.
+    AnalogLUT<T> tanh_lut;          ///< Tanh lookup table.
+
+private:
+    /**
+     * @brief Returns the code of +1 in the device type (1 for floating-point device types).
+     */
+    static double code_max() {
+        return std::numeric_limits<qT>::is_integer ? static_cast<double>(std::numeric_limits<qT>::max()) : 1.0;
+    }
+
+    /**
+     * @brief Rejects overlapping input and recurrent tile ranges before anything is programmed.
+     * @return tile_ih.
+     */
+    static uint16_t check_tiles(uint16_t gates, uint16_t input_size, uint16_t hidden_size,
+                                uint16_t tile_ih, uint16_t tile_hh) {
+        uint32_t gate_rows = static_cast<uint32_t>(gates) * hidden_size;
+        uint32_t n_ih = AnalogTiledLinear<T, qT, oT>::count_tiles(gate_rows, input_size);
+        uint32_t n_hh = AnalogTiledLinear<T, qT, oT>::count_tiles(gate_rows, hidden_size);
+        if (tile_ih < tile_hh + n_hh && tile_hh < tile_ih + n_ih) {
+            std::cerr << "Error: input tiles [" << tile_ih << ", " << tile_ih + n_ih << ") and recurrent tiles ["
+                      << tile_hh << ", " << tile_hh + n_hh << ") of the recurrent cell overlap." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        return tile_ih;
+    }
+};
+
+/**
+ * @class AnalogLSTMCell
+ * @brief LSTM cell with gate order (i, f, g, o).
+ */
+template <typename T, typename qT = T, typename oT = qT>
+class AnalogLSTMCell : public AnalogRecurrentCell<T, qT, oT> {
+public:
+    /**
+     * @brief Constructor of the AnalogLSTMCell class.
+     * @see AnalogRecurrentCell::AnalogRecurrentCell
+     */
+    AnalogLSTMCell(AnalogContext &ctx, T* w_ih, T* w_hh, T* b_ih, T* b_hh,
+                   uint16_t input_size, uint16_t hidden_size,
+                   uint16_t tile_ih, uint16_t tile_hh)
+        : AnalogRecurrentCell<T, qT, oT>(ctx, 4, w_ih, w_hh, b_ih, b_hh,
+                                         input_size, hidden_size, tile_ih, tile_hh),
+          cell(nullptr) {
+        try {
+            cell = new T[hidden_size]();
+        } catch (const std::bad_alloc&) {
+            std::cerr << "Memory allocation failed for LSTM cell state" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    ~AnalogLSTMCell() {
+        delete[] cell;
+    }
+
+    void step(T* x, T* h_out) override {
+        const uint32_t H = this->hidden_size;
+        this->project_input(x);
+
+        T* pre = this->gates_ih.data();
+        T* bias = this->bias;
+        const AnalogLUT<T> &sig = this->sigmoid_lut;
+        const AnalogLUT<T> &tnh = this->tanh_lut;
+        this->project_hidden([&](uint32_t i, T v) {
+            T a = v + pre[i] + bias[i];
+            return (i / H == 2) ? tnh(a) : sig(a);
+        });
+
+        T* act = this->gates_hh.data();
+        for (uint32_t j = 0; j < H; j++) {
+            T i_g = act[j];
+            T f_g = act[H + j];
+            T g_g = act[2 * H + j];
+            T o_g = act[3 * H + j];
+            cell[j] = f_g * cell[j] + i_g * g_g;
+            T h = o_g * tnh(cell[j]);
+            this->write_hidden(j, h);
+            if (h_out) {
+                h_out[j] = h;
+            }
+        }
+    }
+
+    void reset_state() override {
+        AnalogRecurrentCell<T, qT, oT>::reset_state();
+        if (cell) {
+            for (uint32_t j = 0; j < this->hidden_size; j++) {
+                cell[j] = static_cast<T>(0);
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the cell state.
+     * @return Pointer to the cell state (hidden_size).
+     */
+    T* get_cell_state() const {
+        return cell;
+    }
+
+private:
+    T* cell; ///< Cell state, kept in host precision.
+};
+
+/**
+ * @class AnalogGRUCell
+ * @brief GRU cell with gate order (r, z, n).
+ */
+template <typename T, typename qT = T, typename oT = qT>
+class AnalogGRUCell : public AnalogRecurrentCell<T, qT, oT> {
+public:
+    /**
+     * @brief Constructor of the AnalogGRUCell class.
+     * @see AnalogRecurrentCell::AnalogRecurrentCell
+     */
+    AnalogGRUCell(AnalogContext &ctx, T* w_ih, T* w_hh, T* b_ih, T* b_hh,
+                  uint16_t input_size, uint16_t hidden_size,
+                  uint16_t tile_ih, uint16_t tile_hh)
+        : AnalogRecurrentCell<T, qT, oT>(ctx, 3, w_ih, w_hh, b_ih, b_hh,
+                                         input_size, hidden_size, tile_ih, tile_hh) {}
+
+    void step(T* x, T* h_out) override {
+        const uint32_t H = this->hidden_size;
+        this->project_input(x);
+
+        T* pre = this->gates_ih.data();
+        T* act = this->gates_hh.data();
+        T* bias = this->bias;
+        T* bias_hh = this->bias_hh;
+        const AnalogLUT<T> &sig = this->sigmoid_lut;
+        const AnalogLUT<T> &tnh = this->tanh_lut;
+
+        // Elements are produced in index order, so r (first block) is already in act
+        // when the candidate n (third block) needs it.
+        this->project_hidden([&](uint32_t i, T v) {
+            if (i < 2 * H) {
+                return sig(v + pre[i] + bias[i]);
+            }
+            T r = act[i - 2 * H];
+            return tnh(pre[i] + (bias[i] - bias_hh[i]) + r * (v + bias_hh[i]));
+        });
+
+        for (uint32_t j = 0; j < H; j++) {
+            T z = act[H + j];
+            T n = act[2 * H + j];
+            T h = (static_cast<T>(1) - z) * n + z * this->read_hidden(j);
+            this->write_hidden(j, h);
+            if (h_out) {
+                h_out[j] = h;
+            }
+        }
+    }
+};
+
+#endif // ANALOG_RECURRENT_H
@@ -0,0 +1,322 @@
+/**
+ * @file analogRefresh.h
+ * @brief This file contains a background scheduler that reprograms drifting tiles during idle windows.
+ *
+ * Programmed conductances drift, so a tile has to be reprogrammed once it reaches a maximum age
+ * (AnalogContext::get_programming_age). Reprogramming stalls any request that arrives meanwhile,
+ * so the scheduler keeps an exponentially weighted mean of the request inter-arrival gap and of
+ * the refresh cost, and only starts a refresh when no request is in flight, the refresh fits the
+ * latency budget and the predicted idle window is long enough. Tiles that reach a hard age are
+ * refreshed at the next idle moment regardless of the prediction.
+ */
+
+#ifndef ANALOG_REFRESH_H
+#define ANALOG_REFRESH_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "analogMatrix.h"
+#include "analogContext.h"
+#include "analogOperations.h"
+#include "analogLinear.h"
+
+/**
+ * @class AnalogRefreshScheduler
+ * @brief Refreshes watched tiles older than a maximum age when the request stream leaves room for it.
+ */
+class AnalogRefreshScheduler {
+public:
+    /**
+     * @brief Constructor of the AnalogRefreshScheduler class.
+     * @param ctx The analog context whose tiles are refreshed.
+     * @param max_age Age in seconds after which a tile is refreshed in an idle window.
+     * @param latency_budget Longest stall in seconds a refresh may impose on an unexpected request.
+     * @param hard_age Age in seconds after which a tile is refreshed at the next idle moment (default 2 * max_age).
+     */
+    AnalogRefreshScheduler(AnalogContext &ctx, double max_age, double latency_budget, double hard_age = 0.0)
+        : ctx(ctx),
+          max_age(max_age),
+          hard_age(hard_age > 0.0 ? hard_age : 2.0 * max_age),
+          latency_budget(latency_budget),
+          smoothing(0.1),
+          in_flight(0),
+          arrivals(0),
+          last_arrival(0.0),
+          mean_gap(0.0),
+          refresh_cost(latency_budget),
+          cost_measured(false),
+          refreshing(false),
+          refreshes(0),
+          forced_refreshes(0),
+          deferrals(0),
+          collisions(0),
+          stopping(false) {}
+
+    AnalogRefreshScheduler(const AnalogRefreshScheduler&) = delete;
+    AnalogRefreshScheduler& operator=(const AnalogRefreshScheduler&) = delete;
+
+    ~AnalogRefreshScheduler() {
+        stop();
+    }
+
+    /**
+     * @brief Watches a tile refreshed by a callback.
+     * @param tile_id The tile whose programming age is tracked (resolved through the context bindings).
+     * @param refresh Reprograms the tile and returns the status flag; must reset its programming age.
+     */
+    void watch(uint16_t tile_id, std::function<uint16_t()> refresh) {
+        std::lock_guard<std::mutex> lock(poll_mutex);
+        watched.push_back(Watched{tile_id, std::move(refresh)});
+    }
+
+    /**
+     * @brief Watches a matrix set on a tile; it is refreshed in place with mvm_refresh_matrix.
+     */
+    template <typename T, typename qT>
+    void watch(AnalogMatrix<T, qT> &mat, uint16_t tile_id) {
+        AnalogContext &context = ctx;
+        watch(tile_id, [&context, &mat, tile_id]() { return mvm_refresh_matrix(context, mat, tile_id); });
+    }
+
+    /**
+     * @brief Watches a layer; with hot swap enabled it is refreshed on its spare tile.
+     * @see AnalogLinear::refresh
+     */
+    template <typename T, typename qT, typename oT>
+    void watch(AnalogLinear<T, qT, oT> &layer) {
+        watch(layer.get_tile_id(), [&layer]() { return layer.refresh(); });
+    }
+
+    /**
+     * @brief Records the arrival of a request; call before its first operation.
+     */
+    void request_begin() {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        double now = now_seconds();
+        if (arrivals > 0) {
+            double gap = now - last_arrival;
+            mean_gap = arrivals == 1 ? gap : (1.0 - smoothing) * mean_gap + smoothing * gap;
+        }
+        arrivals++;
+        last_arrival = now;
+        in_flight++;
+        if (refreshing.load()) {
+            collisions++;
+        }
+    }
+
+    /**
+     * @brief Records the completion of a request.
+     */
+    void request_end() {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        if (in_flight > 0) {
+            in_flight--;
+        }
+    }
+
+    /**
+     * @brief Returns the predicted seconds until the next request (0 while one is in flight).
+     *
+     * The next request is expected one mean gap after the last one; once that time has passed,
+     * the silence so far is taken as the prediction, since a stalled stream tends to stay stalled.
+     */
+    double predicted_idle() {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        return predicted_idle_locked();
+    }
+
+    /**
+     * @brief Refreshes the oldest stale tiles while the predicted idle window allows it.
+     * @return The number of tiles refreshed.
+     */
+    uint32_t poll() {
+        std::lock_guard<std::mutex> lock(poll_mutex);
+        uint32_t done = 0;
+        for (size_t attempt = 0; attempt < watched.size(); attempt++) {
+            size_t oldest = watched.size();
+            double oldest_age = max_age;
+            for (size_t i = 0; i < watched.size(); i++) {
+                double age = ctx.get_programming_age(ctx.resolve_tile(watched[i].tile_id));
+                if (age >= oldest_age) {
+                    oldest = i;
+                    oldest_age = age;
+                }
+            }
+            if (oldest == watched.size()) {
+                break;
+            }
+
+            bool forced = oldest_age >= hard_age;
+            {
+                std::lock_guard<std::mutex> stats_lock(stats_mutex);
+                bool fits = refresh_cost <= latency_budget && refresh_cost <= predicted_idle_locked();
+                if (in_flight > 0 || (!forced && !fits)) {
+                    deferrals++;
+                    break;
+                }
+                refreshing.store(true);
+            }
+
+            double start = now_seconds();
+            watched[oldest].refresh();
+            double cost = now_seconds() - start;
+            refreshing.store(false);
+
+            std::lock_guard<std::mutex> stats_lock(stats_mutex);
+            refresh_cost = cost_measured ? (1.0 - smoothing) * refresh_cost + smoothing * cost : cost;
+            cost_measured = true;
+            refreshes++;
+            if (forced) {
+                forced_refreshes++;
+            }
+            done++;
+        }
+        return done;
+    }
+
+    /**
+     * @brief Starts a background thread calling poll every interval seconds.
+     */
+    void start(double interval) {
+        stop();
+        stopping = false;
+        worker = std::thread([this, interval]() {
+            std::unique_lock<std::mutex> lock(worker_mutex);
+            while (!stopping) {
+                lock.unlock();
+                poll();
+                lock.lock();
+                worker_cv.wait_for(lock, std::chrono::duration<double>(interval), [this] { return stopping; });
+            }
+        });
+    }
+
+    /**
+     * @brief Stops the background thread, if running.
+     */
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(worker_mutex);
+            stopping = true;
+        }
+        worker_cv.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    /**
+     * @brief Sets the weight of the newest sample in the gap and cost averages (default 0.1).
+     */
+    void set_smoothing(double alpha) {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        smoothing = alpha;
+    }
+
+    /**
+     * @brief Returns the age in seconds of the oldest watched tile.
+     */
+    double get_max_age() {
+        std::lock_guard<std::mutex> lock(poll_mutex);
+        double oldest = 0.0;
+        for (const Watched &w : watched) {
+            double age = ctx.get_programming_age(ctx.resolve_tile(w.tile_id));
+            oldest = age > oldest ? age : oldest;
+        }
+        return oldest;
+    }
+
+    double get_mean_gap() {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        return mean_gap;
+    }
+
+    /**
+     * @brief Returns the mean refresh duration in seconds (the latency budget until one is measured).
+     */
+    double get_refresh_cost() {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        return refresh_cost;
+    }
+
+    uint64_t get_refreshes() const { return refreshes; }
+    uint64_t get_forced_refreshes() const { return forced_refreshes; }
+
+    /**
+     * @brief Returns how often a stale tile was postponed because no idle window was predicted.
+     */
+    uint64_t get_deferrals() const { return deferrals; }
+
+    /**
+     * @brief Returns how many requests arrived while a refresh was running.
+     */
+    uint64_t get_collisions() const { return collisions; }
+
+    uint32_t get_num_watched() {
+        std::lock_guard<std::mutex> lock(poll_mutex);
+        return static_cast<uint32_t>(watched.size());
+    }
+
+private:
+    struct Watched {
+        uint16_t tile_id;                 ///< Tile whose age is tracked.
+        std::function<uint16_t()> refresh; ///< Reprograms the tile.
+    };
+
+    static double now_seconds() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief predicted_idle with stats_mutex held.
+     */
+    double predicted_idle_locked() const {
+        if (in_flight > 0) {
+            return 0.0;
+        }
+        if (arrivals < 2) {
+            return std::numeric_limits<double>::infinity();
+        }
+        double elapsed = now_seconds() - last_arrival;
+        return elapsed < mean_gap ? mean_gap - elapsed : elapsed;
+    }
+
+    AnalogContext &ctx;          ///< Context whose tiles are refreshed.
+    double max_age;              ///< Age at which a tile is refreshed in an idle window.
+    double hard_age;             ///< Age at which a tile is refreshed at the next idle moment.
+    double latency_budget;       ///< Longest stall a refresh may impose.
+    double smoothing;            ///< Weight of the newest sample in the averages.
+
+    uint32_t in_flight;          ///< Requests between request_begin and request_end.
+    uint64_t arrivals;           ///< Requests seen.
+    double last_arrival;         ///< Time of the last request_begin (seconds).
+    double mean_gap;             ///< Mean inter-arrival gap (seconds).
+    double refresh_cost;         ///< Mean refresh duration (seconds).
+    bool cost_measured;          ///< Whether refresh_cost holds a measurement.
+    std::mutex stats_mutex;      ///< Guards the arrival and cost statistics.
+
+    std::atomic<bool> refreshing;          ///< Whether a refresh is running.
+    std::atomic<uint64_t> refreshes;       ///< Refreshes performed.
+    std::atomic<uint64_t> forced_refreshes; ///< Refreshes that ignored the idle prediction.
+    std::atomic<uint64_t> deferrals;       ///< Stale tiles postponed.
+    std::atomic<uint64_t> collisions;      ///< Requests that arrived during a refresh.
+
+    std::vector<Watched> watched;          ///< Watched tiles.
+    std::mutex poll_mutex;                 ///< Serializes poll and guards watched.
+
+    std::thread worker;                    ///< Background polling thread.
+    std::mutex worker_mutex;               ///< Guards stopping.
+    std::condition_variable worker_cv;     ///< Wakes the worker on stop.
+    bool stopping;                         ///< Whether the worker should exit.
+};
+
+#endif // ANALOG_REFRESH_H
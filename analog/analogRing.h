@@ -0,0 +1,298 @@
+/**
+ * @file analogRing.h
+ * @brief This file contains a lock-free multi-producer single-consumer ring of mvm commands.
+ *
+ * Threads that share tiles enqueue load/compute/store descriptors instead of calling the mvm
+ * operations under a per-tile mutex. Producers claim cells with one compare-and-swap on the tail
+ * (a bounded sequence-numbered ring, so no producer ever blocks another inside a critical
+ * section), and a single device-owner thread drains the ring in batches. Completion is published
+ * per command through its ticket; waiters spin briefly and then sleep, and the owner wakes
+ * sleepers at most once per batch.
+ */
+
+#ifndef ANALOG_RING_H
+#define ANALOG_RING_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "analogVector.h"
+#include "analogContext.h"
+#include "analogOperations.h"
+
+/**
+ * @brief Completion of one submitted command; reusable once complete.
+ */
+struct AnalogMvmTicket {
+    AnalogMvmTicket() : done(false), status(0) {}
+
+    std::atomic<bool> done;  ///< Set by the device owner once out holds the result.
+    uint16_t status;         ///< Combined status flags of load, compute and store.
+};
+
+/**
+ * @class AnalogSubmitRing
+ * @brief Bounded lock-free MPSC queue of y = W x commands executed by one device-owner thread.
+ * @tparam T Host data type.
+ * @tparam qT Device data type of the inputs.
+ * @tparam oT Device data type of the outputs.
+ */
+template <typename T, typename qT = T, typename oT = qT>
+class AnalogSubmitRing {
+public:
+    /**
+     * @brief Constructor of the AnalogSubmitRing class.
+     * @param ctx The analog context; only the owner thread may use it while the ring runs.
+     * @param capacity Number of cells, rounded up to a power of two.
+     * @param max_batch Commands drained before completions are signalled to sleeping waiters.
+     * @param spin Polls a waiter (or the idle owner) makes before it sleeps.
+     */
+    AnalogSubmitRing(AnalogContext &ctx, uint32_t capacity = 1024, uint32_t max_batch = 64, uint32_t spin = 1000)
+        : ctx(ctx),
+          cells(round_up(capacity)),
+          mask(cells.size() - 1),
+          max_batch(max_batch > 0 ? max_batch : 1),
+          spin(spin),
+          tail(0),
+          head(0),
+          owner_sleeping(false),
+          sleepers(0),
+          stopping(false),
+          commands(0),
+          batches(0) {
+        for (size_t i = 0; i < cells.size(); i++) {
+            cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    AnalogSubmitRing(const AnalogSubmitRing&) = delete;
+    AnalogSubmitRing& operator=(const AnalogSubmitRing&) = delete;
+
+    ~AnalogSubmitRing() {
+        stop();
+    }
+
+    /**
+     * @brief Enqueues y = W x on a tile unless the ring is full; safe from any number of threads.
+     * @param in Input vector; must stay valid until the ticket completes.
+     * @param out Output vector.
+     * @param tile_id The tile.
+     * @param ticket Completion; must not be pending for another command.
+     * @return Whether the command was enqueued.
+     */
+    bool try_submit(AnalogVector<T, qT> &in, AnalogVector<T, oT> &out, uint16_t tile_id, AnalogMvmTicket &ticket) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // Full: the owner has not consumed this cell's previous lap
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+        ticket.done.store(false, std::memory_order_relaxed);
+        cell->in = &in;
+        cell->out = &out;
+        cell->tile_id = tile_id;
+        cell->ticket = &ticket;
+        cell->seq.store(pos + 1, std::memory_order_seq_cst);
+        if (owner_sleeping.load(std::memory_order_seq_cst)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            owner_cv.notify_one();
+        }
+        return true;
+    }
+
+    /**
+     * @brief Enqueues a command, yielding while the ring is full.
+     */
+    void submit(AnalogVector<T, qT> &in, AnalogVector<T, oT> &out, uint16_t tile_id, AnalogMvmTicket &ticket) {
+        while (!try_submit(in, out, tile_id, ticket)) {
+            std::this_thread::yield();
+        }
+    }
+
+    /**
+     * @brief Waits until a submitted command has completed.
+     * @return Its status flags.
+     */
+    uint16_t wait(AnalogMvmTicket &ticket) {
+        for (uint32_t i = 0; i < spin; i++) {
+            if (ticket.done.load(std::memory_order_acquire)) {
+                return ticket.status;
+            }
+            std::this_thread::yield();
+        }
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done_cv.wait(lock, [&ticket] { return ticket.done.load(std::memory_order_seq_cst); });
+        }
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+        return ticket.status;
+    }
+
+    /**
+     * @brief Executes up to max_batch queued commands on the calling thread, which must be the only consumer.
+     * @return The number of commands executed.
+     */
+    uint32_t drain() {
+        uint32_t n = 0;
+        while (n < max_batch) {
+            Cell &cell = cells[head & mask];
+            if (cell.seq.load(std::memory_order_acquire) != head + 1) {
+                break;
+            }
+            AnalogVector<T, qT>* in = cell.in;
+            AnalogVector<T, oT>* out = cell.out;
+            uint16_t tile_id = cell.tile_id;
+            AnalogMvmTicket* ticket = cell.ticket;
+            cell.seq.store(head + cells.size(), std::memory_order_release);
+            head++;
+
+            uint16_t status = mvm_load_vector(ctx, *in, tile_id);
+            status |= mvm_compute(ctx, tile_id);
+            status |= mvm_store_vector(ctx, *out, tile_id);
+            ticket->status = status;
+            ticket->done.store(true, std::memory_order_seq_cst);
+            n++;
+        }
+        if (n > 0) {
+            commands.fetch_add(n, std::memory_order_relaxed);
+            batches.fetch_add(1, std::memory_order_relaxed);
+            // One wake-up for every sleeper of the batch
+            if (sleepers.load(std::memory_order_seq_cst) > 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done_cv.notify_all();
+            }
+        }
+        return n;
+    }
+
+    /**
+     * @brief Starts the device-owner thread.
+     */
+    void start() {
+        stop();
+        stopping.store(false);
+        owner = std::thread([this] { run(); });
+    }
+
+    /**
+     * @brief Stops the device-owner thread after draining the queued commands.
+     */
+    void stop() {
+        stopping.store(true);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            owner_cv.notify_one();
+        }
+        if (owner.joinable()) {
+            owner.join();
+        }
+    }
+
+    uint64_t get_commands() const {
+        return commands.load();
+    }
+
+    uint64_t get_batches() const {
+        return batches.load();
+    }
+
+    /**
+     * @brief Returns the mean number of commands per drained batch.
+     */
+    double get_mean_batch() const {
+        uint64_t b = batches.load();
+        return b ? static_cast<double>(commands.load()) / b : 0.0;
+    }
+
+    uint32_t get_capacity() const {
+        return static_cast<uint32_t>(cells.size());
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;        ///< pos when free for the producer of pos, pos + 1 once filled.
+        AnalogVector<T, qT>* in;        ///< Input vector.
+        AnalogVector<T, oT>* out;       ///< Output vector.
+        AnalogMvmTicket* ticket;        ///< Completion.
+        uint16_t tile_id;               ///< Tile.
+    };
+
+    static size_t round_up(uint32_t n) {
+        size_t c = 2;
+        while (c < n) {
+            c <<= 1;
+        }
+        return c;
+    }
+
+    bool has_work() const {
+        return cells[head & mask].seq.load(std::memory_order_seq_cst) == head + 1;
+    }
+
+    void run() {
+        uint32_t idle = 0;
+        for (;;) {
+            if (drain() > 0) {
+                idle = 0;
+                continue;
+            }
+            if (stopping.load()) {
+                return;
+            }
+            if (idle++ < spin) {
+                std::this_thread::yield();
+                continue;
+            }
+            owner_sleeping.store(true, std::memory_order_seq_cst);
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                owner_cv.wait_for(lock, std::chrono::milliseconds(1), [this] { return has_work() || stopping.load(); });
+            }
+            owner_sleeping.store(false, std::memory_order_relaxed);
+            idle = 0;
+        }
+    }
+
+    AnalogContext &ctx;                  ///< Context the commands run in.
+    std::vector<Cell> cells;             ///< Ring cells.
+    size_t mask;                         ///< cells.size() - 1.
+    uint32_t max_batch;                  ///< Commands per batch.
+    uint32_t spin;                       ///< Polls before sleeping.
+
+    char pad0[64];                       ///< Keeps tail off the owner's cache line.
+    std::atomic<size_t> tail;            ///< Next position claimed by a producer.
+    char pad1[64];                       ///< Keeps head off the producers' cache line.
+    size_t head;                         ///< Next position drained by the owner.
+    char pad2[64];                       ///< Separates head from the shared flags.
+
+    std::atomic<bool> owner_sleeping;    ///< Whether producers must wake the owner.
+    std::atomic<uint32_t> sleepers;      ///< Waiters blocked on done_cv.
+    std::atomic<bool> stopping;          ///< Whether the owner should drain and exit.
+    std::mutex mutex;                    ///< Guards the sleeps only.
+    std::condition_variable owner_cv;    ///< Wakes the owner on submit or stop.
+    std::condition_variable done_cv;     ///< Wakes waiters after a batch.
+    std::thread owner;                   ///< Device-owner thread.
+
+    std::atomic<uint64_t> commands;      ///< Commands executed.
+    std::atomic<uint64_t> batches;       ///< Non-empty drains.
+};
+
+#endif // ANALOG_RING_H
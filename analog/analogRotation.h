@@ -0,0 +1,294 @@
+/**
+ * @file analogRotation.h
+ * @brief This file contains fast Walsh-Hadamard rotations that flatten weight and activation distributions.
+ *
+ * With the orthonormal (and symmetric) Hadamard matrix H, y = W x = (W H)(H x). Rotating the
+ * weight rows offline and the activation online spreads outliers over all coordinates, so the
+ * absmax scale used by quantize_transfer_to_device wastes fewer codes. An optional output
+ * rotation (H W H) flattens the weight columns too and is undone with one more H after
+ * mvm_store_vector.
+ *
+ * The rotation is block-diagonal: Hadamard blocks of the largest power of two that divides the
+ * tile width (or height, for the output rotation), so padding a dimension to a whole number of
+ * blocks never changes the number of tiles. Outliers are spread within a block only; on a device
+ * whose width is odd the block has size 1 and that dimension is left unrotated.
+ */
+
+#ifndef ANALOG_ROTATION_H
+#define ANALOG_ROTATION_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "analogContext.h"
+#include "analogTiled.h"
+
+/**
+ * @brief Returns the smallest power of two greater than or equal to n.
+ */
+inline uint32_t analog_next_pow2(uint32_t n) {
+    uint32_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+/**
+ * @brief Returns the Hadamard block size for a dimension of length n split into tiles of width device.
+ *
+ * This is the largest power of two that divides device, capped at the smallest power of two that
+ * holds n, so that padding n to a multiple of the block keeps the tile count unchanged.
+ */
+inline uint32_t analog_hadamard_block(uint32_t n, uint32_t device) {
+    uint32_t block = device & (~device + 1);
+    uint32_t cap = analog_next_pow2(n);
+    return block < cap ? block : cap;
+}
+
+/**
+ * @brief Returns n rounded up to a multiple of block.
+ */
+inline uint32_t analog_round_up(uint32_t n, uint32_t block) {
+    return (n + block - 1) / block * block;
+}
+
+/**
+ * @brief In-place orthonormal fast Walsh-Hadamard transform, O(n log n).
+ *
+ * The transform is its own inverse.
+ * @param x Vector to transform.
+ * @param n Length of x; must be a power of two.
+ */
+template <typename T>
+void analog_fwht(T* x, uint32_t n) {
+    for (uint32_t h = 1; h < n; h <<= 1) {
+        for (uint32_t i = 0; i < n; i += 2 * h) {
+            for (uint32_t j = i; j < i + h; j++) {
+                T a = x[j];
+                T b = x[j + h];
+                x[j] = a + b;
+                x[j + h] = a - b;
+            }
+        }
+    }
+    T norm = static_cast<T>(1.0 / std::sqrt(static_cast<double>(n)));
+    for (uint32_t i = 0; i < n; i++) {
+        x[i] *= norm;
+    }
+}
+
+#if defined(__AVX2__)
+/**
+ * @brief AVX2 specialization of analog_fwht for float.
+ *
+ * Strides below 8 stay scalar; wider butterflies and the final scaling use 8-lane vectors.
+ */
+template <>
+inline void analog_fwht<float>(float* x, uint32_t n) {
+    uint32_t h = 1;
+    for (; h < n && h < 8; h <<= 1) {
+        for (uint32_t i = 0; i < n; i += 2 * h) {
+            for (uint32_t j = i; j < i + h; j++) {
+                float a = x[j];
+                float b = x[j + h];
+                x[j] = a + b;
+                x[j + h] = a - b;
+            }
+        }
+    }
+    for (; h < n; h <<= 1) {
+        for (uint32_t i = 0; i < n; i += 2 * h) {
+            for (uint32_t j = i; j < i + h; j += 8) {
+                __m256 a = _mm256_loadu_ps(x + j);
+                __m256 b = _mm256_loadu_ps(x + j + h);
+                _mm256_storeu_ps(x + j, _mm256_add_ps(a, b));
+                _mm256_storeu_ps(x + j + h, _mm256_sub_ps(a, b));
+            }
+        }
+    }
+    float norm = static_cast<float>(1.0 / std::sqrt(static_cast<double>(n)));
+    uint32_t i = 0;
+    __m256 vnorm = _mm256_set1_ps(norm);
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(x + i, _mm256_mul_ps(_mm256_loadu_ps(x + i), vnorm));
+    }
+    for (; i < n; i++) {
+        x[i] *= norm;
+    }
+}
+#endif
+
+/**
+ * @brief Applies analog_fwht to every consecutive block of x.
+ * @param x Vector to transform.
+ * @param n Length of x; must be a multiple of block.
+ * @param block Block size; must be a power of two.
+ */
+template <typename T>
+void analog_block_fwht(T* x, uint32_t n, uint32_t block) {
+    if (block < 2) {
+        return;
+    }
+    for (uint32_t i = 0; i < n; i += block) {
+        analog_fwht(x + i, block);
+    }
+}
+
+/**
+ * @brief Rotates a weight matrix offline: out = H_rows W H_cols with block-diagonal Hadamard matrices.
+ * @param w Row-major weights (rows x cols).
+ * @param rows Number of rows of w.
+ * @param cols Number of columns of w.
+ * @param out Row-major output (padded_rows x padded_cols), zero-padded.
+ * @param padded_rows Multiple of row_block >= rows.
+ * @param padded_cols Multiple of col_block >= cols.
+ * @param row_block Hadamard block along the output dimension; 1 leaves the rows unrotated.
+ * @param col_block Hadamard block along the input dimension.
+ */
+template <typename T>
+void analog_rotate_weights(const T* w, uint32_t rows, uint32_t cols, T* out, uint32_t padded_rows,
+                           uint32_t padded_cols, uint32_t row_block, uint32_t col_block) {
+    for (size_t i = 0; i < static_cast<size_t>(padded_rows) * padded_cols; i++) {
+        out[i] = static_cast<T>(0);
+    }
+    for (uint32_t r = 0; r < rows; r++) {
+        T* row = out + static_cast<size_t>(r) * padded_cols;
+        for (uint32_t c = 0; c < cols; c++) {
+            row[c] = w[static_cast<size_t>(r) * cols + c];
+        }
+        analog_block_fwht(row, padded_cols, col_block);
+    }
+    if (row_block < 2) {
+        return;
+    }
+    std::vector<T> column(padded_rows);
+    for (uint32_t c = 0; c < padded_cols; c++) {
+        for (uint32_t r = 0; r < padded_rows; r++) {
+            column[r] = out[static_cast<size_t>(r) * padded_cols + c];
+        }
+        analog_block_fwht(column.data(), padded_rows, row_block);
+        for (uint32_t r = 0; r < padded_rows; r++) {
+            out[static_cast<size_t>(r) * padded_cols + c] = column[r];
+        }
+    }
+}
+
+/**
+ * @class AnalogRotatedLinear
+ * @brief Tiled layer y = W x executed in a Hadamard-rotated basis.
+ *
+ * The weights are rotated (and padded to whole Hadamard blocks) once at construction; each call
+ * rotates the activation before it is quantized and, with an output rotation, rotates the result
+ * back. The blocks divide the tile dimensions, so the layer occupies as many tiles as an
+ * unrotated AnalogTiledLinear of the same shape.
+ * @tparam T Host data type.
+ * @tparam qT Device data type of weights and inputs.
+ * @tparam oT Device data type of the outputs.
+ * @tparam GroupSize Width of a column block (one tile each); at most DEVICE_COLS.
+ */
+template <typename T, typename qT = T, typename oT = qT, uint16_t GroupSize = DEVICE_COLS>
+class AnalogRotatedLinear {
+public:
+    /**
+     * @brief Constructor of the AnalogRotatedLinear class; rotates and programs the weights.
+     * @param ctx The analog context managing the scales.
+     * @param weights Row-major weights (rows x cols).
+     * @param rows Number of output rows.
+     * @param cols Number of input columns.
+     * @param first_tile The ID of the first tile used by the layer.
+     * @param rotate_output Whether to also rotate along the output dimension.
+     */
+    AnalogRotatedLinear(AnalogContext &ctx, T* weights, uint32_t rows, uint32_t cols,
+                        uint16_t first_tile, bool rotate_output = false)
+        : rows(rows),
+          cols(cols),
+          row_block(rotate_output ? analog_hadamard_block(rows, DEVICE_ROWS) : 1),
+          col_block(analog_hadamard_block(cols, GroupSize)),
+          padded_rows(analog_round_up(rows, row_block)),
+          padded_cols(analog_round_up(cols, col_block)),
+          in_buf(padded_cols),
+          out_buf(padded_rows) {
+        std::vector<T> rotated(static_cast<size_t>(padded_rows) * padded_cols);
+        analog_rotate_weights(weights, rows, cols, rotated.data(), padded_rows, padded_cols, row_block, col_block);
+        layer.reset(new AnalogTiledLinear<T, qT, oT, GroupSize>(ctx, rotated.data(), padded_rows, padded_cols,
+                                                                first_tile));
+    }
+
+    /**
+     * @brief Returns the number of tiles a rotated rows x cols layer occupies.
+     */
+    static uint32_t count_tiles(uint32_t rows, uint32_t cols, bool rotate_output = false) {
+        uint32_t rb = rotate_output ? analog_hadamard_block(rows, DEVICE_ROWS) : 1;
+        uint32_t cb = analog_hadamard_block(cols, GroupSize);
+        return AnalogTiledLinear<T, qT, oT, GroupSize>::count_tiles(analog_round_up(rows, rb),
+                                                                    analog_round_up(cols, cb));
+    }
+
+    /**
+     * @brief Computes y = W x.
+     * @param x Input vector (cols).
+     * @param y Output vector (rows).
+     */
+    void forward(T* x, T* y) {
+        for (uint32_t j = 0; j < cols; j++) {
+            in_buf[j] = x[j];
+        }
+        for (uint32_t j = cols; j < padded_cols; j++) {
+            in_buf[j] = static_cast<T>(0);
+        }
+        analog_block_fwht(in_buf.data(), padded_cols, col_block);
+
+        if (row_block < 2) {
+            layer->forward(in_buf.data(), y);
+            return;
+        }
+        layer->forward(in_buf.data(), out_buf.data());
+        analog_block_fwht(out_buf.data(), padded_rows, row_block);
+        for (uint32_t i = 0; i < rows; i++) {
+            y[i] = out_buf[i];
+        }
+    }
+
+    /**
+     * @brief Returns the underlying tiled layer (in the rotated basis).
+     */
+    AnalogTiledLinear<T, qT, oT, GroupSize>& get_layer() {
+        return *layer;
+    }
+
+    /**
+     * @brief Returns the Hadamard block size along the input dimension.
+     */
+    uint32_t get_col_block() const {
+        return col_block;
+    }
+
+    /**
+     * @brief Returns the Hadamard block size along the output dimension (1 when unrotated).
+     */
+    uint32_t get_row_block() const {
+        return row_block;
+    }
+
+private:
+    uint32_t rows;           ///< Number of output rows.
+    uint32_t cols;           ///< Number of input columns.
+    uint32_t row_block;      ///< Hadamard block along the output dimension.
+    uint32_t col_block;      ///< Hadamard block along the input dimension.
+    uint32_t padded_rows;    ///< Rows of the rotated weights.
+    uint32_t padded_cols;    ///< Columns of the rotated weights.
+    std::vector<T> in_buf;   ///< Rotated input.
+    std::vector<T> out_buf;  ///< Rotated output.
+    std::unique_ptr<AnalogTiledLinear<T, qT, oT, GroupSize>> layer; ///< Layer holding the rotated weights.
+};
+
+#endif // ANALOG_ROTATION_H
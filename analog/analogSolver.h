@@ -0,0 +1,297 @@
+/**
+ * @file analogSolver.h
+ * @brief This file contains iterative solvers (Jacobi, conjugate gradient, power iteration) on programmed tiles.
+ *
+ * The system matrix is programmed once and every iteration only issues load/compute/store
+ * calls. Inner iterations are limited by the quantized matrix-vector product; iterative
+ * refinement recovers full accuracy by computing the residual b - A x on the host in double
+ * precision and solving only for the correction on the tiles.
+ */
+
+#ifndef ANALOG_SOLVER_H
+#define ANALOG_SOLVER_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "analogContext.h"
+#include "analogTiled.h"
+
+/**
+ * @brief Inner solver used by AnalogSolver::refine.
+ */
+enum class AnalogSolverMethod {
+    JACOBI,            ///< x += D^-1 (b - A x); needs a diagonally dominant A.
+    CONJUGATE_GRADIENT ///< Conjugate gradient; needs a symmetric positive definite A.
+};
+
+/**
+ * @struct AnalogSolverStats
+ * @brief Convergence report of a solver call.
+ */
+struct AnalogSolverStats {
+    AnalogSolverStats() : iterations(0), matvecs(0), residual(0.0), converged(false) {}
+
+    uint32_t iterations; ///< Iterations executed (outer iterations for refine).
+    uint32_t matvecs;    ///< Matrix-vector products issued on the tiles.
+    double residual;     ///< Final relative residual (or relative eigenvalue change for power iteration).
+    bool converged;      ///< Whether the tolerance was reached.
+};
+
+/**
+ * @class AnalogSolver
+ * @brief Square system A (n x n) programmed once on tiles and reused by iterative methods.
+ * @tparam T Host data type.
+ * @tparam qT Device data type of weights and inputs.
+ * @tparam oT Device data type of the outputs.
+ */
+template <typename T, typename qT = T, typename oT = qT>
+class AnalogSolver {
+public:
+    /**
+     * @brief Constructor of the AnalogSolver class; copies and programs the matrix.
+     * @param ctx The analog context managing the scales.
+     * @param a Row-major system matrix (n x n).
+     * @param n Dimension of the system.
+     * @param first_tile The ID of the first tile used.
+     */
+    AnalogSolver(AnalogContext &ctx, T* a, uint32_t n, uint16_t first_tile)
+        : n(n),
+          layer(ctx, a, n, n, first_tile),
+          inv_diag(n),
+          r(n),
+          p(n),
+          ap(n),
+          d(n) {
+        for (uint32_t i = 0; i < n; i++) {
+            T a_ii = a[static_cast<size_t>(i) * n + i];
+            inv_diag[i] = a_ii != 0 ? static_cast<T>(1) / a_ii : static_cast<T>(0);
+        }
+    }
+
+    AnalogSolver(const AnalogSolver&) = delete;
+    AnalogSolver& operator=(const AnalogSolver&) = delete;
+
+    /**
+     * @brief Returns the number of tiles an n x n system occupies.
+     */
+    static uint32_t count_tiles(uint32_t n) {
+        return AnalogTiledLinear<T, qT, oT>::count_tiles(n, n);
+    }
+
+    /**
+     * @brief Jacobi iteration with the matrix-vector product on the tiles.
+     * @param b Right-hand side (n).
+     * @param x Initial guess on entry, solution on exit (n).
+     * @param max_iter Maximum number of iterations.
+     * @param tol Relative residual at which to stop.
+     */
+    AnalogSolverStats jacobi(const T* b, T* x, uint32_t max_iter, double tol) {
+        AnalogSolverStats stats;
+        double b_norm = norm(b);
+        for (uint32_t k = 0; k < max_iter; k++) {
+            layer.forward(x, ap.data());
+            stats.matvecs++;
+            for (uint32_t i = 0; i < n; i++) {
+                r[i] = b[i] - ap[i];
+            }
+            stats.residual = relative(norm(r.data()), b_norm);
+            if (stats.residual < tol) {
+                stats.converged = true;
+                break;
+            }
+            for (uint32_t i = 0; i < n; i++) {
+                x[i] += inv_diag[i] * r[i];
+            }
+            stats.iterations++;
+        }
+        return stats;
+    }
+
+    /**
+     * @brief Conjugate gradient with the matrix-vector product on the tiles.
+     *
+     * The reported residual is the recursively updated one; with a quantized product it drifts
+     * below the true residual, which refine measures on the host.
+     * @param b Right-hand side (n).
+     * @param x Initial guess on entry, solution on exit (n).
+     * @param max_iter Maximum number of iterations.
+     * @param tol Relative residual at which to stop.
+     */
+    AnalogSolverStats conjugate_gradient(const T* b, T* x, uint32_t max_iter, double tol) {
+        AnalogSolverStats stats;
+        double b_norm = norm(b);
+        layer.forward(x, ap.data());
+        stats.matvecs++;
+        for (uint32_t i = 0; i < n; i++) {
+            r[i] = b[i] - ap[i];
+            p[i] = r[i];
+        }
+        double rr = dot(r.data(), r.data());
+        stats.residual = relative(std::sqrt(rr), b_norm);
+        for (uint32_t k = 0; k < max_iter && stats.residual >= tol; k++) {
+            layer.forward(p.data(), ap.data());
+            stats.matvecs++;
+            double pap = dot(p.data(), ap.data());
+            if (pap <= 0.0) {
+                break; // Not positive definite (or lost to quantization noise)
+            }
+            double alpha = rr / pap;
+            for (uint32_t i = 0; i < n; i++) {
+                x[i] += static_cast<T>(alpha * p[i]);
+                r[i] -= static_cast<T>(alpha * ap[i]);
+            }
+            double rr_new = dot(r.data(), r.data());
+            for (uint32_t i = 0; i < n; i++) {
+                p[i] = static_cast<T>(r[i] + rr_new / rr * p[i]);
+            }
+            rr = rr_new;
+            stats.residual = relative(std::sqrt(rr), b_norm);
+            stats.iterations++;
+        }
+        stats.converged = stats.residual < tol;
+        return stats;
+    }
+
+    /**
+     * @brief Power iteration for the dominant eigenpair.
+     * @param v Initial vector on entry, normalized eigenvector on exit (n). A zero vector is
+     *          returned unchanged with eigenvalue 0 and unconverged stats.
+     * @param eigenvalue Rayleigh quotient of the final vector.
+     * @param max_iter Maximum number of iterations.
+     * @param tol Relative change of the eigenvalue at which to stop.
+     */
+    AnalogSolverStats power_iteration(T* v, T &eigenvalue, uint32_t max_iter, double tol) {
+        AnalogSolverStats stats;
+        double v_norm = norm(v);
+        if (v_norm == 0.0) {
+            eigenvalue = static_cast<T>(0);
+            return stats;
+        }
+        scale(v, 1.0 / v_norm);
+        double lambda = 0.0;
+        for (uint32_t k = 0; k < max_iter; k++) {
+            layer.forward(v, ap.data());
+            stats.matvecs++;
+            double lambda_new = dot(v, ap.data());
+            double ap_norm = norm(ap.data());
+            if (ap_norm == 0.0) {
+                break;
+            }
+            for (uint32_t i = 0; i < n; i++) {
+                v[i] = static_cast<T>(ap[i] / ap_norm);
+            }
+            stats.iterations++;
+            stats.residual = relative(std::abs(lambda_new - lambda), std::abs(lambda_new));
+            lambda = lambda_new;
+            if (k > 0 && stats.residual < tol) {
+                stats.converged = true;
+                break;
+            }
+        }
+        eigenvalue = static_cast<T>(lambda);
+        return stats;
+    }
+
+    /**
+     * @brief Mixed-precision iterative refinement.
+     *
+     * Each outer iteration computes r = b - A x in double precision from the host copy of A,
+     * solves A d = r approximately on the tiles and updates x += d. The accuracy of the result
+     * is set by the host residual; the tiles only have to reduce the error by a constant factor.
+     * The residual stays in double; the inner solver receives it normalized to unit length, so
+     * rounding it to T loses only relative precision however small it becomes, and the
+     * correction is scaled back and added to x in double.
+     * @param b Right-hand side (n).
+     * @param x Initial guess on entry, solution on exit (n).
+     * @param method Inner solver.
+     * @param inner_iter Iterations of the inner solver per outer iteration.
+     * @param max_outer Maximum number of outer iterations.
+     * @param tol Relative residual at which to stop.
+     */
+    AnalogSolverStats refine(const T* b, T* x, AnalogSolverMethod method, uint32_t inner_iter,
+                             uint32_t max_outer, double tol) {
+        AnalogSolverStats stats;
+        double b_norm = norm(b);
+        const T* a = layer.get_host_weights();
+        std::vector<double> residual(n);
+        std::vector<T> rhs(n);
+        for (uint32_t k = 0; k <= max_outer; k++) {
+            double rr = 0.0;
+            for (uint32_t i = 0; i < n; i++) {
+                const T* a_row = a + static_cast<size_t>(i) * n;
+                double acc = b[i];
+                for (uint32_t j = 0; j < n; j++) {
+                    acc -= static_cast<double>(a_row[j]) * x[j];
+                }
+                residual[i] = acc;
+                rr += acc * acc;
+            }
+            double r_norm = std::sqrt(rr);
+            stats.residual = relative(r_norm, b_norm);
+            if (stats.residual < tol || r_norm == 0.0) {
+                stats.converged = stats.residual < tol;
+                break;
+            }
+            if (k == max_outer) {
+                break;
+            }
+
+            for (uint32_t i = 0; i < n; i++) {
+                rhs[i] = static_cast<T>(residual[i] / r_norm);
+                d[i] = static_cast<T>(0);
+            }
+            AnalogSolverStats inner = method == AnalogSolverMethod::JACOBI
+                                    ? jacobi(rhs.data(), d.data(), inner_iter, 0.0)
+                                    : conjugate_gradient(rhs.data(), d.data(), inner_iter, 0.0);
+            stats.matvecs += inner.matvecs;
+            for (uint32_t i = 0; i < n; i++) {
+                x[i] = static_cast<T>(static_cast<double>(x[i]) + r_norm * d[i]);
+            }
+            stats.iterations++;
+        }
+        return stats;
+    }
+
+    uint32_t get_dimension() const {
+        return n;
+    }
+
+    AnalogTiledLinear<T, qT, oT>& get_layer() {
+        return layer;
+    }
+
+private:
+    double dot(const T* u, const T* v) const {
+        double acc = 0.0;
+        for (uint32_t i = 0; i < n; i++) {
+            acc += static_cast<double>(u[i]) * v[i];
+        }
+        return acc;
+    }
+
+    double norm(const T* u) const {
+        return std::sqrt(dot(u, u));
+    }
+
+    void scale(T* u, double s) const {
+        for (uint32_t i = 0; i < n; i++) {
+            u[i] = static_cast<T>(u[i] * s);
+        }
+    }
+
+    static double relative(double value, double reference) {
+        return reference > 0.0 ? value / reference : value;
+    }
+
+    uint32_t n;                          ///< Dimension of the system.
+    AnalogTiledLinear<T, qT, oT> layer;  ///< System matrix on the tiles.
+    std::vector<T> inv_diag;             ///< Inverse diagonal of A (Jacobi).
+    std::vector<T> r;                    ///< Residual.
+    std::vector<T> p;                    ///< Search direction (CG).
+    std::vector<T> ap;                   ///< Product of A with the current vector.
+    std::vector<T> d;                    ///< Correction of the refinement step.
+};
+
+#endif // ANALOG_SOLVER_H
@@ -0,0 +1,399 @@
+/**
+ * @file analogSparse.h
+ * @brief This file contains CSR/COO host matrices and a tiled SpMV layer that only maps non-empty blocks.
+ *
+ * The matrix is never densified: each DEVICE_ROWS x DEVICE_COLS block that holds at least one
+ * non-zero is scattered into a single tile-sized staging buffer, quantized and programmed, and
+ * only its device codes are kept. Empty blocks cost neither tiles nor MVMs.
+ */
+
+#ifndef ANALOG_SPARSE_H
+#define ANALOG_SPARSE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "analogMatrix.h"
+#include "analogVector.h"
+#include "analogContext.h"
+#include "analogOperations.h"
+#include "analogDigital.h"
+
+/**
+ * @struct AnalogCSR
+ * @brief Compressed sparse row host matrix.
+ */
+template <typename T>
+struct AnalogCSR {
+    uint32_t rows;                 ///< Number of rows.
+    uint32_t cols;                 ///< Number of columns.
+    std::vector<uint64_t> row_ptr; ///< Start of every row in col_idx/values (rows + 1).
+    std::vector<uint32_t> col_idx; ///< Column of every non-zero.
+    std::vector<T> values;         ///< Value of every non-zero.
+
+    uint64_t nnz() const {
+        return values.size();
+    }
+};
+
+/**
+ * @brief Converts a COO matrix (triplets in any order) to CSR; duplicate entries are summed.
+ * @param rows Number of rows.
+ * @param cols Number of columns.
+ * @param nnz Number of triplets.
+ * @param row_idx Row of every triplet.
+ * @param col_idx Column of every triplet.
+ * @param values Value of every triplet.
+ * @return The CSR matrix with sorted columns in every row.
+ */
+template <typename T>
+AnalogCSR<T> analog_coo_to_csr(uint32_t rows, uint32_t cols, uint64_t nnz,
+                               const uint32_t* row_idx, const uint32_t* col_idx, const T* values) {
+    std::vector<uint64_t> order(nnz);
+    for (uint64_t k = 0; k < nnz; k++) {
+        order[k] = k;
+    }
+    std::sort(order.begin(), order.end(), [&](uint64_t a, uint64_t b) {
+        return row_idx[a] != row_idx[b] ? row_idx[a] < row_idx[b] : col_idx[a] < col_idx[b];
+    });
+
+    AnalogCSR<T> csr;
+    csr.rows = rows;
+    csr.cols = cols;
+    csr.row_ptr.assign(static_cast<size_t>(rows) + 1, 0);
+    bool have_prev = false;
+    uint32_t prev_row = 0;
+    uint32_t prev_col = 0;
+    for (uint64_t k : order) {
+        if (row_idx[k] >= rows || col_idx[k] >= cols) {
+            std::cerr << "Error: COO entry (" << row_idx[k] << ", " << col_idx[k]
+                      << ") is outside a " << rows << "x" << cols << " matrix." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        if (have_prev && row_idx[k] == prev_row && col_idx[k] == prev_col) {
+            csr.values.back() += values[k];
+            continue;
+        }
+        csr.col_idx.push_back(col_idx[k]);
+        csr.values.push_back(values[k]);
+        csr.row_ptr[row_idx[k] + 1]++;
+        have_prev = true;
+        prev_row = row_idx[k];
+        prev_col = col_idx[k];
+    }
+    for (uint32_t i = 0; i < rows; i++) {
+        csr.row_ptr[i + 1] += csr.row_ptr[i];
+    }
+    return csr;
+}
+
+/**
+ * @class AnalogSparseLinear
+ * @brief SpMV layer y = A x over a CSR matrix, with one tile per non-empty block.
+ *
+ * Non-empty blocks are assigned consecutive tiles from first_tile in (row block, column block)
+ * order. Blocks beyond the tiles left in the context are still quantized and run on the host
+ * from their device codes, so the layer degrades gracefully instead of failing.
+ * @tparam T Host data type.
+ * @tparam qT Device data type of weights and inputs.
+ * @tparam oT Device data type of the outputs.
+ */
+template <typename T, typename qT = T, typename oT = qT>
+class AnalogSparseLinear {
+public:
+    /**
+     * @brief Constructor of the AnalogSparseLinear class; maps, quantizes and programs the non-empty blocks.
+     * @param ctx The analog context managing the scales.
+     * @param csr The host matrix; not referenced after construction.
+     * @param first_tile The ID of the first tile used by the layer.
+     */
+    AnalogSparseLinear(AnalogContext &ctx, const AnalogCSR<T> &csr, uint16_t first_tile)
+        : ctx(ctx),
+          rows(csr.rows),
+          cols(csr.cols),
+          row_blocks((csr.rows + DEVICE_ROWS - 1) / DEVICE_ROWS),
+          col_blocks((csr.cols + DEVICE_COLS - 1) / DEVICE_COLS),
+          first_tile(first_tile),
+          num_analog(0),
+          skipped_blocks(0),
+          staging(DEVICE_ROWS * DEVICE_COLS),
+          staging_rows(DEVICE_ROWS),
+          segment_of(col_blocks, -1),
+          out_vec(DEVICE_ROWS) {
+        for (uint32_t i = 0; i < DEVICE_ROWS; i++) {
+            staging_rows[i] = staging.data() + i * DEVICE_COLS;
+        }
+        uint32_t tiles_left = first_tile < ctx.get_num_arrays() ? ctx.get_num_arrays() - first_tile : 0;
+
+        struct Entry {
+            uint32_t cb;
+            uint16_t i;
+            uint16_t j;
+            T v;
+        };
+        std::vector<Entry> entries;
+        for (uint32_t rb = 0; rb < row_blocks; rb++) {
+            // Gather the non-zeros of the row block and group them by column block
+            entries.clear();
+            uint32_t row_end = std::min(rows, (rb + 1) * DEVICE_ROWS);
+            for (uint32_t r = rb * DEVICE_ROWS; r < row_end; r++) {
+                for (uint64_t k = csr.row_ptr[r]; k < csr.row_ptr[r + 1]; k++) {
+                    if (csr.values[k] == 0) {
+                        continue;
+                    }
+                    uint32_t c = csr.col_idx[k];
+                    entries.push_back({c / DEVICE_COLS, static_cast<uint16_t>(r - rb * DEVICE_ROWS),
+                                       static_cast<uint16_t>(c % DEVICE_COLS), csr.values[k]});
+                }
+            }
+            std::stable_sort(entries.begin(), entries.end(),
+                             [](const Entry &a, const Entry &b) { return a.cb < b.cb; });
+
+            for (size_t e = 0; e < entries.size();) {
+                uint32_t cb = entries[e].cb;
+                std::fill(staging.begin(), staging.end(), static_cast<T>(0));
+                uint32_t nnz = 0;
+                for (; e < entries.size() && entries[e].cb == cb; e++, nnz++) {
+                    staging_rows[entries[e].i][entries[e].j] += entries[e].v;
+                }
+
+                Block blk;
+                blk.rb = rb;
+                blk.cb = cb;
+                blk.nnz = nnz;
+                blk.mat.reset(new AnalogMatrix<T, qT>(staging_rows.data(), block_height(rb), block_width(cb)));
+                if (num_analog < tiles_left) {
+                    blk.tile_id = static_cast<int32_t>(first_tile + num_analog++);
+                    mvm_set_matrix(ctx, *blk.mat, static_cast<uint16_t>(blk.tile_id));
+                } else {
+                    blk.tile_id = -1;
+                    digital_set_matrix(*blk.mat);
+                }
+                blocks.push_back(std::move(blk));
+
+                if (segment_of[cb] < 0) {
+                    segment_of[cb] = static_cast<int32_t>(segments.size());
+                    segments.emplace_back(new AnalogVector<T, qT>(block_width(cb)));
+                    segment_cols.push_back(cb);
+                }
+            }
+        }
+        segment_scales.assign(segments.size(), 1.0);
+    }
+
+    AnalogSparseLinear(const AnalogSparseLinear&) = delete;
+    AnalogSparseLinear& operator=(const AnalogSparseLinear&) = delete;
+
+    /**
+     * @brief Computes y = A x.
+     *
+     * Only the input segments read by a non-empty block are quantized, and blocks whose
+     * segment is zero are skipped.
+     * @param x Input vector (cols).
+     * @param y Output vector (rows).
+     */
+    void forward(const T* x, T* y) {
+        for (size_t s = 0; s < segments.size(); s++) {
+            uint32_t cb = segment_cols[s];
+            T* seg = segments[s]->get_host_arr();
+            for (uint32_t j = 0; j < block_width(cb); j++) {
+                seg[j] = x[cb * DEVICE_COLS + j];
+            }
+            segments[s]->set_scale_factor(1.0);
+            segments[s]->transfer_to_device();
+            segment_scales[s] = segments[s]->get_scale_factor();
+        }
+
+        for (uint32_t i = 0; i < rows; i++) {
+            y[i] = static_cast<T>(0);
+        }
+
+        T* out_host = out_vec.get_host_arr();
+        oT partial[DEVICE_ROWS];
+        for (Block &blk : blocks) {
+            uint32_t s = static_cast<uint32_t>(segment_of[blk.cb]);
+            if (segments[s]->is_zero()) {
+                skipped_blocks++;
+                continue;
+            }
+            T* y_blk = y + blk.rb * DEVICE_ROWS;
+            if (blk.tile_id >= 0) {
+                uint16_t tile_id = static_cast<uint16_t>(blk.tile_id);
+                segments[s]->set_scale_factor(segment_scales[s]);
+                mvm_load_device_vector(ctx, *segments[s], tile_id);
+                mvm_compute(ctx, tile_id);
+                mvm_store_vector(ctx, out_vec, tile_id);
+                for (uint32_t i = 0; i < block_height(blk.rb); i++) {
+                    y_blk[i] += out_host[i];
+                }
+            } else {
+                AnalogMatrix<T, qT> &mat = *blk.mat;
+                digital_gemv(mat.get_device_mat(), mat.get_device_cols(), segments[s]->get_device_arr(),
+                             partial, block_height(blk.rb), block_width(blk.cb));
+                int64_t offset = segments[s]->get_input_offset();
+                double scale = segment_scales[s] * mat.get_scale_factor();
+                for (uint32_t i = 0; i < block_height(blk.rb); i++) {
+                    int64_t acc = static_cast<int64_t>(partial[i]) + (offset ? offset * mat.get_row_sums()[i] : 0);
+                    y_blk[i] += static_cast<T>(acc * scale);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Selects the input encoding of every segment (e.g. AUTO for non-negative rank vectors).
+     * @see AnalogVector::set_input_encoding
+     */
+    void set_input_encoding(AnalogInputEncoding encoding) {
+        for (auto &seg : segments) {
+            seg->set_input_encoding(encoding);
+        }
+    }
+
+    /**
+     * @brief Sets the magnitude at or below which an input segment is treated as zero and its blocks skipped.
+     * @see AnalogVector::set_zero_threshold
+     */
+    void set_zero_threshold(T threshold) {
+        for (auto &seg : segments) {
+            seg->set_zero_threshold(threshold);
+        }
+    }
+
+    /**
+     * @brief Returns the number of block MVMs skipped because their input segment was zero.
+     */
+    uint64_t get_skipped_blocks() const {
+        return skipped_blocks;
+    }
+
+    /**
+     * @brief Returns the number of non-zeros in block (rb, cb); 0 for unmapped blocks.
+     */
+    uint32_t get_block_occupancy(uint32_t rb, uint32_t cb) const {
+        auto it = std::lower_bound(blocks.begin(), blocks.end(), std::make_pair(rb, cb),
+                                   [](const Block &b, const std::pair<uint32_t, uint32_t> &key) {
+                                       return b.rb != key.first ? b.rb < key.first : b.cb < key.second;
+                                   });
+        return it != blocks.end() && it->rb == rb && it->cb == cb ? it->nnz : 0;
+    }
+
+    /**
+     * @brief Returns the number of non-empty blocks.
+     */
+    uint32_t get_num_blocks() const {
+        return static_cast<uint32_t>(blocks.size());
+    }
+
+    /**
+     * @brief Returns the number of non-empty blocks programmed on tiles (the rest run on the host).
+     */
+    uint32_t get_num_tiles() const {
+        return num_analog;
+    }
+
+    /**
+     * @brief Returns the fraction of all row x column blocks that are non-empty.
+     */
+    double get_block_density() const {
+        double total = static_cast<double>(row_blocks) * col_blocks;
+        return total > 0.0 ? blocks.size() / total : 0.0;
+    }
+
+    uint32_t get_rows() const { return rows; }
+    uint32_t get_cols() const { return cols; }
+
+    /**
+     * @brief Returns the number of valid rows in row block rb.
+     */
+    uint16_t block_height(uint32_t rb) const {
+        uint32_t left = rows - rb * DEVICE_ROWS;
+        return static_cast<uint16_t>(left < DEVICE_ROWS ? left : DEVICE_ROWS);
+    }
+
+    /**
+     * @brief Returns the number of valid columns in column block cb.
+     */
+    uint16_t block_width(uint32_t cb) const {
+        uint32_t left = cols - cb * DEVICE_COLS;
+        return static_cast<uint16_t>(left < DEVICE_COLS ? left : DEVICE_COLS);
+    }
+
+private:
+    /**
+     * @brief A non-empty block. Its AnalogMatrix references the shared staging rows, so only its
+     *        device codes are meaningful after construction; it must not be re-quantized.
+     */
+    struct Block {
+        uint32_t rb;                                ///< Row block.
+        uint32_t cb;                                ///< Column block.
+        uint32_t nnz;                               ///< Non-zeros in the block.
+        int32_t tile_id;                            ///< Tile holding the block, or -1 for the host.
+        std::unique_ptr<AnalogMatrix<T, qT>> mat;   ///< Quantized block.
+    };
+
+    AnalogContext &ctx;          ///< Context the blocks are programmed in.
+    uint32_t rows;               ///< Number of rows.
+    uint32_t cols;               ///< Number of columns.
+    uint32_t row_blocks;         ///< Number of row blocks.
+    uint32_t col_blocks;         ///< Number of column blocks.
+    uint16_t first_tile;         ///< Tile of the first non-empty block.
+    uint32_t num_analog;         ///< Blocks programmed on tiles.
+    uint64_t skipped_blocks;     ///< Block MVMs skipped because their input segment was zero.
+
+    std::vector<T> staging;                                     ///< Dense tile-sized scatter buffer.
+    std::vector<T*> staging_rows;                               ///< Row pointers into staging.
+    std::vector<Block> blocks;                                  ///< Non-empty blocks, by (rb, cb).
+    std::vector<int32_t> segment_of;                            ///< Segment of every column block, or -1.
+    std::vector<uint32_t> segment_cols;                         ///< Column block of every segment.
+    std::vector<std::unique_ptr<AnalogVector<T, qT>>> segments; ///< Quantized input segments.
+    std::vector<double> segment_scales;                         ///< Input scale of every segment.
+    AnalogVector<T, oT> out_vec;                                ///< Output staging for the tiles.
+};
+
+/**
+ * @brief PageRank by power iteration on a column-stochastic link matrix.
+ *
+ * Each step computes rank' = damping * M rank on the layer and spreads the missing mass
+ * (teleportation and dangling nodes) uniformly, so rank stays a distribution.
+ * @param layer Layer holding M (n x n), M[i][j] = 1 / outdeg(j) for every link j -> i.
+ * @param rank Initial distribution on entry, PageRank on exit (n).
+ * @param damping Damping factor.
+ * @param max_iter Maximum number of iterations.
+ * @param tol L1 change at which to stop.
+ * @return The number of iterations executed.
+ */
+template <typename T, typename qT, typename oT>
+uint32_t analog_pagerank(AnalogSparseLinear<T, qT, oT> &layer, T* rank, double damping,
+                         uint32_t max_iter, double tol) {
+    uint32_t n = layer.get_rows();
+    std::vector<T> next(n);
+    uint32_t k = 0;
+    while (k < max_iter) {
+        layer.forward(rank, next.data());
+        k++;
+        double sum = 0.0;
+        for (uint32_t i = 0; i < n; i++) {
+            next[i] = static_cast<T>(damping * (next[i] > 0 ? next[i] : 0));
+            sum += next[i];
+        }
+        T spread = static_cast<T>((1.0 - sum) / n);
+        double delta = 0.0;
+        for (uint32_t i = 0; i < n; i++) {
+            next[i] += spread;
+            delta += std::abs(next[i] - rank[i]);
+            rank[i] = next[i];
+        }
+        if (delta < tol) {
+            break;
+        }
+    }
+    return k;
+}
+
+#endif // ANALOG_SPARSE_H
@@ -0,0 +1,138 @@
+/**
+ * @file analogThreadPool.h
+ * @brief This file contains a fixed-size host thread pool used by the parallel executors.
+ */
+
+#ifndef ANALOG_THREAD_POOL_H
+#define ANALOG_THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class AnalogThreadPool
+ * @brief Fixed set of worker threads draining a FIFO task queue.
+ */
+class AnalogThreadPool {
+public:
+    /**
+     * @brief Constructor of the AnalogThreadPool class.
+     * @param num_threads Number of worker threads; 0 uses std::thread::hardware_concurrency().
+     */
+    explicit AnalogThreadPool(uint32_t num_threads = 0)
+        : stopping(false) {
+        if (num_threads == 0) {
+            num_threads = std::thread::hardware_concurrency();
+        }
+        if (num_threads == 0) {
+            num_threads = 1;
+        }
+        for (uint32_t i = 0; i < num_threads; i++) {
+            workers.emplace_back([this] { worker_loop(); });
+        }
+    }
+
+    /**
+     * @brief Destructor; finishes queued tasks and joins the workers.
+     */
+    ~AnalogThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    AnalogThreadPool(const AnalogThreadPool&) = delete;
+    AnalogThreadPool& operator=(const AnalogThreadPool&) = delete;
+
+    /**
+     * @brief Queues a task.
+     * @param fn Callable taking no arguments.
+     * @return A future completed when the task has run.
+     */
+    template <typename F>
+    std::future<void> submit(F fn) {
+        auto task = std::make_shared<std::packaged_task<void()>>(fn);
+        std::future<void> done = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.emplace_back([task] { (*task)(); });
+        }
+        cv.notify_one();
+        return done;
+    }
+
+    /**
+     * @brief Runs fn(i) for every i in [begin, end) and waits for completion.
+     *
+     * The range is split into one contiguous chunk per worker, so the partition (and any
+     * per-chunk reduction built on it) only depends on the range and the pool size.
+     * @param begin First index.
+     * @param end One past the last index.
+     * @param fn Callable invoked as fn(i).
+     */
+    template <typename F>
+    void parallel_for(uint32_t begin, uint32_t end, F fn) {
+        if (end <= begin) {
+            return;
+        }
+        uint32_t n = end - begin;
+        uint32_t chunks = size() < n ? size() : n;
+        std::vector<std::future<void>> pending;
+        for (uint32_t c = 0; c < chunks; c++) {
+            uint32_t lo = begin + static_cast<uint32_t>(static_cast<uint64_t>(n) * c / chunks);
+            uint32_t hi = begin + static_cast<uint32_t>(static_cast<uint64_t>(n) * (c + 1) / chunks);
+            pending.push_back(submit([lo, hi, &fn] {
+                for (uint32_t i = lo; i < hi; i++) {
+                    fn(i);
+                }
+            }));
+        }
+        for (auto &p : pending) {
+            p.get();
+        }
+    }
+
+    /**
+     * @brief Returns the number of worker threads.
+     */
+    uint32_t size() const {
+        return static_cast<uint32_t>(workers.size());
+    }
+
+private:
+    void worker_loop() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers;          ///< Worker threads.
+    std::deque<std::function<void()>> tasks;   ///< Pending tasks.
+    std::mutex mutex;                          ///< Protects tasks and stopping.
+    std::condition_variable cv;                ///< Signals new tasks or shutdown.
+    bool stopping;                             ///< Set when the pool is being destroyed.
+};
+
+#endif // ANALOG_THREAD_POOL_H
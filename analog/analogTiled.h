@@ -0,0 +1,627 @@
+/**
+ * @file analogTiled.h
+ * @brief This file contains the AnalogTiledLinear layer, which spreads a large matrix over several tiles.
+ */
+
+#ifndef ANALOG_TILED_H
+#define ANALOG_TILED_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <exception>  // For std::bad_alloc
+
+#include "analogMatrix.h"
+#include "analogVector.h"
+#include "analogContext.h"
+#include "analogOperations.h"
+#include "analogDigital.h"
+
+/**
+ * @class AnalogTiledLinear
+ * @brief Fully connected layer y = W x whose weights are split into DEVICE_ROWS x GroupSize blocks.
+ *
+ * Block (rb, cb) is programmed on tile first_tile + rb * col_blocks + cb. The input is split into
+ * col_blocks segments, each quantized once per call with its own scale, and the dequantized
+ * partial outputs of a row block are accumulated digitally. Row blocks can be executed on the
+ * tiles or on the host (from the same quantized blocks), which lets executors divide a layer
+ * between the crossbar and CPU threads.
+ *
+ * With group scales, every block is quantized with one scale per row (see
+ * AnalogMatrix::set_row_scaling), so each (row, column group) pair has its own weight scale on
+ * top of the per-segment input scale; both are applied while accumulating the partial outputs.
+ *
+ * Input segments that are entirely zero (or below set_zero_threshold) are detected during their
+ * quantization scan and their blocks are skipped on both paths, so sparse (post-ReLU) inputs
+ * save load/compute/store passes in proportion to their block sparsity.
+ *
+ * forward_batch runs several inputs weight-stationary: all inputs are quantized first, then
+ * every tile serves the whole batch before the next tile is addressed.
+ * @tparam T Host data type.
+ * @tparam qT Device data type of weights and inputs.
+ * @tparam oT Device data type of the outputs.
+ * @tparam GroupSize Width of a column block (one tile each); at most DEVICE_COLS.
+ */
+template <typename T, typename qT = T, typename oT = qT, uint16_t GroupSize = DEVICE_COLS>
+class AnalogTiledLinear {
+    static_assert(GroupSize > 0 && GroupSize <= DEVICE_COLS, "GroupSize must be in [1, DEVICE_COLS]");
+
+public:
+    /**
+     * @brief Constructor of the AnalogTiledLinear class; copies and programs the weights.
+     * @param ctx The analog context managing the scales.
+     * @param weights Row-major weights (rows x cols).
+     * @param rows Number of output rows.
+     * @param cols Number of input columns.
+     * @param first_tile The ID of the first tile used by the layer.
+     * @param group_scales Whether to quantize every row of every block with its own scale.
+     * @param pool Optional threads that quantize the blocks concurrently (same codes as serial).
+     */
+    AnalogTiledLinear(AnalogContext &ctx, T* weights, uint32_t rows, uint32_t cols, uint16_t first_tile,
+                      bool group_scales = false, AnalogThreadPool* pool = nullptr)
+        : ctx(ctx),
+          rows(rows),
+          cols(cols),
+          row_blocks((rows + DEVICE_ROWS - 1) / DEVICE_ROWS),
+          col_blocks((cols + GroupSize - 1) / GroupSize),
+          first_tile(first_tile),
+          host_weights(nullptr),
+          outlier_threshold(0),
+          zero_threshold(0),
+          input_encoding(AnalogInputEncoding::SIGNED),
+          zero_segments(0),
+          skipped_blocks(0),
+          executed_blocks(0),
+          out_vec(DEVICE_ROWS) {
+        if (first_tile + get_num_tiles() > ctx.get_num_arrays()) {
+            std::cerr << "Error: tiled layer needs " << get_num_tiles() << " tiles from tile "
+                      << first_tile << " but the context has " << ctx.get_num_arrays() << "." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        try {
+            host_weights = new T[static_cast<size_t>(rows) * cols];
+        } catch (const std::bad_alloc&) {
+            std::cerr << "Memory allocation failed for tiled host weights" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < static_cast<size_t>(rows) * cols; i++) {
+            host_weights[i] = weights[i];
+        }
+
+        block_rows.resize(get_num_tiles());
+        for (uint32_t rb = 0; rb < row_blocks; rb++) {
+            for (uint32_t cb = 0; cb < col_blocks; cb++) {
+                uint32_t b = rb * col_blocks + cb;
+                block_rows[b].resize(block_height(rb));
+                for (uint32_t i = 0; i < block_height(rb); i++) {
+                    block_rows[b][i] = host_weights + static_cast<size_t>(rb * DEVICE_ROWS + i) * cols
+                                     + cb * GroupSize;
+                }
+                blocks.emplace_back(new AnalogMatrix<T, qT>(block_rows[b].data(),
+                                                            block_height(rb), block_width(cb)));
+                blocks[b]->set_row_scaling(group_scales);
+            }
+        }
+
+        std::vector<AnalogMatrix<T, qT>*> block_ptrs(get_num_tiles());
+        std::vector<uint16_t> tile_ids(get_num_tiles());
+        for (uint32_t b = 0; b < get_num_tiles(); b++) {
+            block_ptrs[b] = blocks[b].get();
+            tile_ids[b] = get_tile_id(b / col_blocks, b % col_blocks);
+        }
+        if (pool) {
+            mvm_set_matrices(ctx, block_ptrs.data(), tile_ids.data(), get_num_tiles(), *pool);
+        } else {
+            for (uint32_t b = 0; b < get_num_tiles(); b++) {
+                mvm_set_matrix(ctx, *block_ptrs[b], tile_ids[b]);
+            }
+        }
+
+        for (uint32_t cb = 0; cb < col_blocks; cb++) {
+            segments.emplace_back(new AnalogVector<T, qT>(block_width(cb)));
+        }
+        segment_scales.assign(col_blocks, 1.0);
+        segment_zero.assign(col_blocks, 0);
+    }
+
+    ~AnalogTiledLinear() {
+        delete[] host_weights;
+    }
+
+    AnalogTiledLinear(const AnalogTiledLinear&) = delete;
+    AnalogTiledLinear& operator=(const AnalogTiledLinear&) = delete;
+
+    /**
+     * @brief Splits and quantizes the input into per-column-block segments.
+     * @param x Input vector (cols).
+     */
+    void quantize_input(T* x) {
+        zero_segments = quantize_segments(x, segments, segment_scales, segment_zero, outlier_cols, outlier_vals);
+    }
+
+    /**
+     * @brief Returns the device codes of input segment cb (block_width(cb) elements).
+     *
+     * Producers that quantize the input themselves write the codes here and then call
+     * set_device_input instead of quantize_input.
+     */
+    qT* get_segment_codes(uint32_t cb) const {
+        return segments[cb]->get_device_arr();
+    }
+
+    /**
+     * @brief Takes the codes written through get_segment_codes as the current input.
+     * @param scale Host value of one code step, shared by all segments.
+     */
+    void set_device_input(double scale) {
+        zero_segments = 0;
+        for (uint32_t cb = 0; cb < col_blocks; cb++) {
+            segments[cb]->set_device_scale(scale);
+            segment_scales[cb] = scale;
+            segment_zero[cb] = segments[cb]->is_zero() ? 1 : 0;
+            zero_segments += segment_zero[cb];
+        }
+        outlier_cols.clear();
+        outlier_vals.clear();
+    }
+
+    /**
+     * @brief Enables LLM.int8-style outlier decomposition of the input.
+     *
+     * Input columns whose magnitude exceeds the threshold are left out of the quantized segments
+     * (so they do not set the segment scale) and multiplied digitally against the host-precision
+     * weights; the two results are summed in the epilogue of every row.
+     * @param threshold Magnitude above which an input column is an outlier; 0 disables it.
+     */
+    void set_outlier_threshold(T threshold) {
+        outlier_threshold = threshold;
+        for (auto &seg : segments) {
+            seg->set_outlier_threshold(threshold);
+        }
+        for (auto &slot : batch_slots) {
+            for (auto &seg : slot->segments) {
+                seg->set_outlier_threshold(threshold);
+            }
+        }
+        outlier_cols.clear();
+        outlier_vals.clear();
+    }
+
+    /**
+     * @brief Selects the input encoding of every segment.
+     *
+     * Segments are encoded independently, so with AUTO a non-negative segment gets the unsigned
+     * range even if other segments of the same input are signed.
+     * @param encoding The encoding to use.
+     * @see AnalogVector::set_input_encoding
+     */
+    void set_input_encoding(AnalogInputEncoding encoding) {
+        input_encoding = encoding;
+        for (auto &seg : segments) {
+            seg->set_input_encoding(encoding);
+        }
+        for (auto &slot : batch_slots) {
+            for (auto &seg : slot->segments) {
+                seg->set_input_encoding(encoding);
+            }
+        }
+    }
+
+    /**
+     * @brief Sets the magnitude at or below which an input segment is treated as zero and skipped.
+     * @param threshold Largest skipped magnitude; 0 (the default) skips exact zeros only.
+     * @see AnalogVector::set_zero_threshold
+     */
+    void set_zero_threshold(T threshold) {
+        zero_threshold = threshold;
+        for (auto &seg : segments) {
+            seg->set_zero_threshold(threshold);
+        }
+        for (auto &slot : batch_slots) {
+            for (auto &seg : slot->segments) {
+                seg->set_zero_threshold(threshold);
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the number of zero segments in the last quantized input.
+     */
+    uint32_t get_zero_segment_count() const {
+        return zero_segments;
+    }
+
+    /**
+     * @brief Returns the number of block MVMs skipped because their input segment was zero.
+     */
+    uint64_t get_skipped_blocks() const {
+        return skipped_blocks.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Returns the number of block MVMs executed (on tiles or on the host).
+     */
+    uint64_t get_executed_blocks() const {
+        return executed_blocks.load(std::memory_order_relaxed);
+    }
+
+    void reset_skip_counters() {
+        skipped_blocks.store(0, std::memory_order_relaxed);
+        executed_blocks.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Returns the number of outlier columns in the last quantized input.
+     */
+    uint32_t get_outlier_count() const {
+        return static_cast<uint32_t>(outlier_cols.size());
+    }
+
+    /**
+     * @brief Computes the rows of row blocks [rb_begin, rb_end) on the tiles.
+     *
+     * quantize_input must have been called for the current input.
+     * @param rb_begin First row block.
+     * @param rb_end One past the last row block.
+     * @param y Output vector (rows); only the rows of the given blocks are written.
+     * @param op Epilogue invoked as op(row, value) once per finished row, fused into the
+     *           accumulation of the last column block.
+     */
+    template <typename Op>
+    void forward_rows_analog(uint32_t rb_begin, uint32_t rb_end, T* y, Op op) {
+        T* out_host = out_vec.get_host_arr();
+        const T zeros[DEVICE_ROWS] = {};
+        uint64_t skipped = 0;
+        for (uint32_t rb = rb_begin; rb < rb_end; rb++) {
+            T* y_blk = y + rb * DEVICE_ROWS;
+            for (uint32_t i = 0; i < block_height(rb); i++) {
+                y_blk[i] = static_cast<T>(0);
+            }
+            for (uint32_t cb = 0; cb < col_blocks; cb++) {
+                if (segment_zero[cb]) {
+                    skipped++;
+                    accumulate(rb, cb, y_blk, zeros, 1.0, *blocks[rb * col_blocks + cb], op);
+                    continue;
+                }
+                uint16_t tile_id = get_tile_id(rb, cb);
+                // mvm_compute folds the matrix scale into the segment, restore it per tile.
+                segments[cb]->set_scale_factor(segment_scales[cb]);
+                mvm_load_device_vector(ctx, *segments[cb], tile_id);
+                mvm_compute(ctx, tile_id);
+                mvm_store_vector(ctx, out_vec, tile_id);
+                accumulate(rb, cb, y_blk, out_host, 1.0, *blocks[rb * col_blocks + cb], op);
+            }
+        }
+        count_blocks(rb_begin, rb_end, skipped);
+    }
+
+    void forward_rows_analog(uint32_t rb_begin, uint32_t rb_end, T* y) {
+        forward_rows_analog(rb_begin, rb_end, y, [](uint32_t, T v) { return v; });
+    }
+
+    /**
+     * @brief Computes the rows of row blocks [rb_begin, rb_end) on the host CPU.
+     *
+     * Uses the same quantized blocks and segments as the tiles. Only reads shared state, so
+     * calls on disjoint row-block ranges may run concurrently with each other and with
+     * forward_rows_analog.
+     * @param rb_begin First row block.
+     * @param rb_end One past the last row block.
+     * @param y Output vector (rows); only the rows of the given blocks are written.
+     * @param op Epilogue invoked as op(row, value) once per finished row.
+     */
+    template <typename Op>
+    void forward_rows_digital(uint32_t rb_begin, uint32_t rb_end, T* y, Op op) {
+        oT partial[DEVICE_ROWS];
+        const T zeros[DEVICE_ROWS] = {};
+        uint64_t skipped = 0;
+        for (uint32_t rb = rb_begin; rb < rb_end; rb++) {
+            T* y_blk = y + rb * DEVICE_ROWS;
+            for (uint32_t i = 0; i < block_height(rb); i++) {
+                y_blk[i] = static_cast<T>(0);
+            }
+            for (uint32_t cb = 0; cb < col_blocks; cb++) {
+                AnalogMatrix<T, qT> &blk = *blocks[rb * col_blocks + cb];
+                if (segment_zero[cb]) {
+                    skipped++;
+                    accumulate(rb, cb, y_blk, zeros, 1.0, blk, op);
+                    continue;
+                }
+                digital_gemv(blk.get_device_mat(), blk.get_device_cols(), segments[cb]->get_device_arr(),
+                             partial, block_height(rb), block_width(cb));
+                int64_t offset = segments[cb]->get_input_offset();
+                if (offset != 0) {
+                    const int64_t* sums = blk.get_row_sums();
+                    for (uint32_t i = 0; i < block_height(rb); i++) {
+                        partial[i] = static_cast<oT>(partial[i] + offset * sums[i]);
+                    }
+                }
+                accumulate(rb, cb, y_blk, partial, segment_scales[cb] * blk.get_scale_factor(), blk, op);
+            }
+        }
+        count_blocks(rb_begin, rb_end, skipped);
+    }
+
+    void forward_rows_digital(uint32_t rb_begin, uint32_t rb_end, T* y) {
+        forward_rows_digital(rb_begin, rb_end, y, [](uint32_t, T v) { return v; });
+    }
+
+    /**
+     * @brief Computes y = W x entirely on the tiles.
+     * @param x Input vector (cols).
+     * @param y Output vector (rows).
+     */
+    void forward(T* x, T* y) {
+        quantize_input(x);
+        forward_rows_analog(0, row_blocks, y);
+    }
+
+    /**
+     * @brief Computes y = op(W x) entirely on the tiles.
+     * @param x Input vector (cols).
+     * @param y Output vector (rows).
+     * @param op Epilogue invoked as op(row, value) once per output row.
+     */
+    template <typename Op>
+    void forward(T* x, T* y, Op op) {
+        quantize_input(x);
+        forward_rows_analog(0, row_blocks, y, op);
+    }
+
+    /**
+     * @brief Computes y_v = W x_v for a batch of inputs on the tiles, weight-stationary.
+     *
+     * All inputs are quantized up front into per-vector segments; the blocks are then visited
+     * once each, and every tile runs the load/compute/store of the whole batch back to back,
+     * so block state (scales, row scales, tile binding) is fetched once per batch rather than
+     * once per vector. The results equal n calls of forward.
+     * @param xs Input vectors (n, each cols).
+     * @param ys Output vectors (n, each rows).
+     * @param n Number of vectors.
+     */
+    void forward_batch(T* const* xs, T* const* ys, uint32_t n) {
+        while (batch_slots.size() < n) {
+            batch_slots.emplace_back(new InputSlot());
+            InputSlot &slot = *batch_slots.back();
+            for (uint32_t cb = 0; cb < col_blocks; cb++) {
+                slot.segments.emplace_back(new AnalogVector<T, qT>(block_width(cb)));
+                slot.segments.back()->set_outlier_threshold(outlier_threshold);
+                slot.segments.back()->set_zero_threshold(zero_threshold);
+                slot.segments.back()->set_input_encoding(input_encoding);
+            }
+            slot.scales.assign(col_blocks, 1.0);
+            slot.zero.assign(col_blocks, 0);
+        }
+        for (uint32_t v = 0; v < n; v++) {
+            InputSlot &slot = *batch_slots[v];
+            quantize_segments(xs[v], slot.segments, slot.scales, slot.zero, slot.outlier_cols, slot.outlier_vals);
+            for (uint32_t i = 0; i < rows; i++) {
+                ys[v][i] = static_cast<T>(0);
+            }
+        }
+
+        T* out_host = out_vec.get_host_arr();
+        uint64_t skipped = 0;
+        for (uint32_t rb = 0; rb < row_blocks; rb++) {
+            for (uint32_t cb = 0; cb < col_blocks; cb++) {
+                const AnalogMatrix<T, qT> &blk = *blocks[rb * col_blocks + cb];
+                uint16_t tile_id = get_tile_id(rb, cb);
+                bool row_scaled = blk.has_row_scaling();
+                for (uint32_t v = 0; v < n; v++) {
+                    InputSlot &slot = *batch_slots[v];
+                    if (slot.zero[cb]) {
+                        skipped++;
+                        continue;
+                    }
+                    slot.segments[cb]->set_scale_factor(slot.scales[cb]);
+                    mvm_load_device_vector(ctx, *slot.segments[cb], tile_id);
+                    mvm_compute(ctx, tile_id);
+                    mvm_store_vector(ctx, out_vec, tile_id);
+                    T* y_blk = ys[v] + rb * DEVICE_ROWS;
+                    for (uint32_t i = 0; i < block_height(rb); i++) {
+                        double row_scale = row_scaled ? blk.get_row_scale(i) : 1.0;
+                        y_blk[i] = static_cast<T>(y_blk[i] + out_host[i] * row_scale);
+                    }
+                }
+            }
+        }
+        for (uint32_t v = 0; v < n; v++) {
+            const InputSlot &slot = *batch_slots[v];
+            if (!slot.outlier_cols.empty()) {
+                for (uint32_t row = 0; row < rows; row++) {
+                    ys[v][row] += outlier_dot(row, slot.outlier_cols, slot.outlier_vals);
+                }
+            }
+        }
+        uint64_t total = static_cast<uint64_t>(get_num_tiles()) * n;
+        skipped_blocks.fetch_add(skipped, std::memory_order_relaxed);
+        executed_blocks.fetch_add(total - skipped, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Returns the owned host-precision copy of the weights (row-major, rows x cols).
+     */
+    const T* get_host_weights() const { return host_weights; }
+
+    uint32_t get_rows() const { return rows; }
+    uint32_t get_cols() const { return cols; }
+    uint32_t get_row_blocks() const { return row_blocks; }
+    uint32_t get_col_blocks() const { return col_blocks; }
+    uint32_t get_num_tiles() const { return row_blocks * col_blocks; }
+
+    /**
+     * @brief Returns the number of tiles a rows x cols layer occupies.
+     */
+    static uint32_t count_tiles(uint32_t rows, uint32_t cols) {
+        return ((rows + DEVICE_ROWS - 1) / DEVICE_ROWS) * ((cols + GroupSize - 1) / GroupSize);
+    }
+
+    /**
+     * @brief Returns the tile holding block (rb, cb).
+     */
+    uint16_t get_tile_id(uint32_t rb, uint32_t cb) const {
+        return static_cast<uint16_t>(first_tile + rb * col_blocks + cb);
+    }
+
+    /**
+     * @brief Returns the number of valid rows in row block rb.
+     */
+    uint16_t block_height(uint32_t rb) const {
+        uint32_t left = rows - rb * DEVICE_ROWS;
+        return static_cast<uint16_t>(left < DEVICE_ROWS ? left : DEVICE_ROWS);
+    }
+
+    /**
+     * @brief Returns the number of valid columns in column block cb.
+     */
+    uint16_t block_width(uint32_t cb) const {
+        uint32_t left = cols - cb * GroupSize;
+        return static_cast<uint16_t>(left < GroupSize ? left : GroupSize);
+    }
+
+private:
+    /**
+     * @brief Quantized input of one vector of a batch.
+     */
+    struct InputSlot {
+        std::vector<std::unique_ptr<AnalogVector<T, qT>>> segments; ///< Quantized input segments.
+        std::vector<double> scales;                                 ///< Input scale of every segment.
+        std::vector<uint8_t> zero;                                  ///< Whether each segment is zero.
+        std::vector<uint32_t> outlier_cols;                         ///< Input columns computed digitally.
+        std::vector<T> outlier_vals;                                ///< Input values of outlier_cols.
+    };
+
+    /**
+     * @brief Copies column block cb of x into seg. Full blocks run a GroupSize trip count, so the
+     *        copy is unrolled at compile time for every instantiated block width.
+     */
+    void copy_segment(uint32_t cb, const T* x, T* seg) const {
+        const T* src = x + cb * GroupSize;
+        if (block_width(cb) == GroupSize) {
+            for (uint32_t j = 0; j < GroupSize; j++) {
+                seg[j] = src[j];
+            }
+            return;
+        }
+        for (uint32_t j = 0; j < block_width(cb); j++) {
+            seg[j] = src[j];
+        }
+    }
+
+    /**
+     * @brief Splits and quantizes x into segs, recording scales, zero segments and outliers.
+     * @return The number of zero segments.
+     */
+    uint32_t quantize_segments(T* x, std::vector<std::unique_ptr<AnalogVector<T, qT>>> &segs,
+                               std::vector<double> &scales, std::vector<uint8_t> &zero,
+                               std::vector<uint32_t> &ocols, std::vector<T> &ovals) {
+        uint32_t zeros = 0;
+        ocols.clear();
+        ovals.clear();
+        for (uint32_t cb = 0; cb < col_blocks; cb++) {
+            copy_segment(cb, x, segs[cb]->get_host_arr());
+            segs[cb]->set_scale_factor(1.0);
+            segs[cb]->transfer_to_device();
+            scales[cb] = segs[cb]->get_scale_factor();
+            zero[cb] = segs[cb]->is_zero() ? 1 : 0;
+            zeros += zero[cb];
+            for (uint32_t j : segs[cb]->get_outliers()) {
+                ocols.push_back(cb * GroupSize + j);
+                ovals.push_back(x[cb * GroupSize + j]);
+            }
+        }
+        return zeros;
+    }
+
+    /**
+     * @brief Adds the scaled partial output of block (rb, cb) to y_blk, applying op after the last column block.
+     */
+    template <typename P, typename Op>
+    void accumulate(uint32_t rb, uint32_t cb, T* y_blk, const P* partial, double scale,
+                    const AnalogMatrix<T, qT> &blk, Op &op) {
+        bool last = cb + 1 == col_blocks;
+        bool row_scaled = blk.has_row_scaling();
+        for (uint32_t i = 0; i < block_height(rb); i++) {
+            double row_scale = row_scaled ? scale * blk.get_row_scale(i) : scale;
+            T v = static_cast<T>(y_blk[i] + partial[i] * row_scale);
+            if (last) {
+                uint32_t row = rb * DEVICE_ROWS + i;
+                if (!outlier_cols.empty()) {
+                    v += outlier_dot(row, outlier_cols, outlier_vals);
+                }
+                v = op(row, v);
+            }
+            y_blk[i] = v;
+        }
+    }
+
+    /**
+     * @brief Adds the blocks of row blocks [rb_begin, rb_end) to the skip counters.
+     */
+    void count_blocks(uint32_t rb_begin, uint32_t rb_end, uint64_t skipped) {
+        uint64_t total = static_cast<uint64_t>(rb_end - rb_begin) * col_blocks;
+        skipped_blocks.fetch_add(skipped, std::memory_order_relaxed);
+        executed_blocks.fetch_add(total - skipped, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Host-precision contribution of the outlier input columns to one output row.
+     */
+    T outlier_dot(uint32_t row, const std::vector<uint32_t> &ocols, const std::vector<T> &ovals) const {
+        const T* w_row = host_weights + static_cast<size_t>(row) * cols;
+        double acc = 0.0;
+        for (size_t k = 0; k < ocols.size(); k++) {
+            acc += static_cast<double>(w_row[ocols[k]]) * ovals[k];
+        }
+        return static_cast<T>(acc);
+    }
+
+    AnalogContext &ctx;          ///< Context the blocks are programmed in.
+    uint32_t rows;               ///< Number of output rows.
+    uint32_t cols;               ///< Number of input columns.
+    uint32_t row_blocks;         ///< Number of row blocks.
+    uint32_t col_blocks;         ///< Number of column blocks.
+    uint16_t first_tile;         ///< Tile of block (0, 0).
+    T* host_weights;             ///< Owned copy of the weights, referenced by the blocks.
+    T outlier_threshold;         ///< Outlier threshold of the input segments.
+    T zero_threshold;            ///< Zero threshold of the input segments.
+    AnalogInputEncoding input_encoding; ///< Encoding of the input segments.
+
+    std::vector<std::vector<T*>> block_rows;                       ///< Row pointers of every block.
+    std::vector<std::unique_ptr<AnalogMatrix<T, qT>>> blocks;      ///< Quantized weight blocks.
+    std::vector<std::unique_ptr<AnalogVector<T, qT>>> segments;    ///< Quantized input segments.
+    std::vector<double> segment_scales;                            ///< Input scale of every segment.
+    std::vector<uint32_t> outlier_cols;                            ///< Input columns computed digitally.
+    std::vector<T> outlier_vals;                                   ///< Input values of outlier_cols.
+    std::vector<uint8_t> segment_zero;                             ///< Whether each segment of the input is zero.
+    uint32_t zero_segments;                                        ///< Zero segments in the last input.
+    std::atomic<uint64_t> skipped_blocks;                          ///< Block MVMs skipped so far.
+    std::atomic<uint64_t> executed_blocks;                         ///< Block MVMs executed so far.
+    AnalogVector<T, oT> out_vec;                                   ///< Output staging for the tiles.
+    std::vector<std::unique_ptr<InputSlot>> batch_slots;           ///< Quantized inputs of forward_batch.
+};
+
+/**
+ * @class AnalogGroupedLinear
+ * @brief AnalogTiledLinear with group-wise weight quantization along the input dimension.
+ *
+ * Every GroupSize-wide column group maps onto its own tile and carries one scale per row.
+ * GroupSize == DEVICE_COLS uses the full tile width; smaller groups trade tiles for resolution.
+ */
+template <typename T, typename qT = T, typename oT = qT, uint16_t GroupSize = DEVICE_COLS>
+class AnalogGroupedLinear : public AnalogTiledLinear<T, qT, oT, GroupSize> {
+public:
+    /**
+     * @brief Constructor of the AnalogGroupedLinear class; copies, quantizes and programs the weights.
+     * @see AnalogTiledLinear::AnalogTiledLinear
+     */
+    AnalogGroupedLinear(AnalogContext &ctx, T* weights, uint32_t rows, uint32_t cols, uint16_t first_tile,
+                        AnalogThreadPool* pool = nullptr)
+        : AnalogTiledLinear<T, qT, oT, GroupSize>(ctx, weights, rows, cols, first_tile, true, pool) {}
+};
+
+#endif // ANALOG_TILED_H
@@ -0,0 +1,302 @@
+/**
+ * @file analogTransformer.h
+ * @brief This file contains a decoder transformer block with resident projection weights.
+ */
+
+#ifndef ANALOG_TRANSFORMER_H
+#define ANALOG_TRANSFORMER_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "analogContext.h"
+#include "analogTiled.h"
+#include "analogKernels.h"
+
+/**
+ * @brief Normalization used by a transformer block.
+ */
+enum class AnalogNorm {
+    LAYERNORM, ///< (x - mean) / std * gamma + beta
+    RMSNORM    ///< x / rms * gamma
+};
+
+/**
+ * @struct AnalogTransformerWeights
+ * @brief Host weights of a transformer block. All matrices are row-major; biases and norm parameters may be nullptr.
+ */
+template <typename T>
+struct AnalogTransformerWeights {
+    T* wq = nullptr;          ///< Query projection (d_model x d_model).
+    T* wk = nullptr;          ///< Key projection (d_model x d_model).
+    T* wv = nullptr;          ///< Value projection (d_model x d_model).
+    T* wo = nullptr;          ///< Output projection (d_model x d_model).
+    T* w1 = nullptr;          ///< FFN up projection (d_ff x d_model).
+    T* w2 = nullptr;          ///< FFN down projection (d_model x d_ff).
+    T* bq = nullptr;          ///< Query bias (d_model).
+    T* bk = nullptr;          ///< Key bias (d_model).
+    T* bv = nullptr;          ///< Value bias (d_model).
+    T* bo = nullptr;          ///< Output bias (d_model).
+    T* b1 = nullptr;          ///< FFN up bias (d_ff).
+    T* b2 = nullptr;          ///< FFN down bias (d_model).
+    T* norm1_gamma = nullptr; ///< Attention norm scale (d_model).
+    T* norm1_beta = nullptr;  ///< Attention norm shift (d_model), LayerNorm only.
+    T* norm2_gamma = nullptr; ///< FFN norm scale (d_model).
+    T* norm2_beta = nullptr;  ///< FFN norm shift (d_model), LayerNorm only.
+};
+
+/**
+ * @class AnalogTransformerBlock
+ * @brief Pre-norm decoder block for token-by-token decoding.
+ *
+ * The static projections (fused QKV, O, FFN up and down) are programmed once on tiles through
+ * AnalogTiledLinear. Attention scores against the KV cache are dynamic and run digitally on the
+ * host. Biases, residual adds, GELU and the statistics of the second norm are fused into the
+ * epilogues of the projections, so each projection output is written once. The FFN down
+ * projection also gathers the statistics of the block output; passing them to the next block's
+ * decode lets its first norm skip the statistics pass as well.
+ * @tparam T Host data type.
+ * @tparam qT Device data type of weights and inputs.
+ * @tparam oT Device data type of the outputs.
+ */
+template <typename T, typename qT = T, typename oT = qT>
+class AnalogTransformerBlock {
+public:
+    /**
+     * @brief Constructor of the AnalogTransformerBlock class; programs all projections.
+     * @param ctx The analog context managing the scales.
+     * @param weights Host weights, copied.
+     * @param d_model Model width.
+     * @param n_heads Number of attention heads; must divide d_model.
+     * @param d_ff FFN hidden width.
+     * @param max_seq Capacity of the KV cache in tokens.
+     * @param first_tile The ID of the first tile used by the block.
+     * @param norm Normalization type.
+     */
+    AnalogTransformerBlock(AnalogContext &ctx, const AnalogTransformerWeights<T> &weights,
+                           uint32_t d_model, uint32_t n_heads, uint32_t d_ff, uint32_t max_seq,
+                           uint16_t first_tile, AnalogNorm norm = AnalogNorm::LAYERNORM)
+        : d_model(d_model),
+          n_heads(n_heads),
+          head_dim(n_heads ? d_model / n_heads : 0),
+          d_ff(d_ff),
+          max_seq(max_seq),
+          position(0),
+          norm(norm),
+          tanh_lut(make_tanh_lut<T>()) {
+        if (n_heads == 0 || d_model % n_heads != 0) {
+            std::cerr << "Error: d_model " << d_model << " is not divisible by " << n_heads << " heads." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        // Stack Q, K and V so the block input is quantized once for all three.
+        std::vector<T> w_qkv(static_cast<size_t>(3) * d_model * d_model);
+        T* parts[3] = {weights.wq, weights.wk, weights.wv};
+        for (uint32_t p = 0; p < 3; p++) {
+            for (size_t i = 0; i < static_cast<size_t>(d_model) * d_model; i++) {
+                w_qkv[p * d_model * d_model + i] = parts[p][i];
+            }
+        }
+
+        uint16_t tile = first_tile;
+        qkv.reset(new AnalogTiledLinear<T, qT, oT>(ctx, w_qkv.data(), 3 * d_model, d_model, tile));
+        tile += qkv->get_num_tiles();
+        proj_o.reset(new AnalogTiledLinear<T, qT, oT>(ctx, weights.wo, d_model, d_model, tile));
+        tile += proj_o->get_num_tiles();
+        ffn_up.reset(new AnalogTiledLinear<T, qT, oT>(ctx, weights.w1, d_ff, d_model, tile));
+        tile += ffn_up->get_num_tiles();
+        ffn_down.reset(new AnalogTiledLinear<T, qT, oT>(ctx, weights.w2, d_model, d_ff, tile));
+
+        b_qkv.assign(3 * d_model, static_cast<T>(0));
+        copy_param(b_qkv.data(), weights.bq, d_model);
+        copy_param(b_qkv.data() + d_model, weights.bk, d_model);
+        copy_param(b_qkv.data() + 2 * d_model, weights.bv, d_model);
+        b_o = make_param(weights.bo, d_model, 0);
+        b_1 = make_param(weights.b1, d_ff, 0);
+        b_2 = make_param(weights.b2, d_model, 0);
+        norm1_gamma = make_param(weights.norm1_gamma, d_model, 1);
+        norm1_beta = make_param(weights.norm1_beta, d_model, 0);
+        norm2_gamma = make_param(weights.norm2_gamma, d_model, 1);
+        norm2_beta = make_param(weights.norm2_beta, d_model, 0);
+
+        k_cache.assign(static_cast<size_t>(max_seq) * d_model, static_cast<T>(0));
+        v_cache.assign(static_cast<size_t>(max_seq) * d_model, static_cast<T>(0));
+        normed.assign(d_model, static_cast<T>(0));
+        qkv_out.assign(3 * d_model, static_cast<T>(0));
+        attn.assign(d_model, static_cast<T>(0));
+        resid.assign(d_model, static_cast<T>(0));
+        ff.assign(d_ff, static_cast<T>(0));
+        scores.assign(max_seq, static_cast<T>(0));
+    }
+
+    /**
+     * @brief Returns the number of tiles a block of the given shape occupies.
+     */
+    static uint32_t tiles_required(uint32_t d_model, uint32_t d_ff) {
+        return AnalogTiledLinear<T, qT, oT>::count_tiles(3 * d_model, d_model)
+             + AnalogTiledLinear<T, qT, oT>::count_tiles(d_model, d_model)
+             + AnalogTiledLinear<T, qT, oT>::count_tiles(d_ff, d_model)
+             + AnalogTiledLinear<T, qT, oT>::count_tiles(d_model, d_ff);
+    }
+
+    /**
+     * @brief Decodes one token, appending its keys and values to the cache.
+     * @param x Block input (d_model); overwritten with the block output.
+     * @return False if the KV cache is full, in which case x is left untouched.
+     */
+    bool decode(T* x) {
+        return decode(x, analog_moments(x, d_model));
+    }
+
+    /**
+     * @brief Decodes one token whose input statistics are already known.
+     * @param x Block input (d_model); overwritten with the block output.
+     * @param x_moments Moments of x, e.g. get_output_moments() of the previous block.
+     * @return False if the KV cache is full, in which case x is left untouched.
+     */
+    bool decode(T* x, const AnalogMoments<T> &x_moments) {
+        if (position >= max_seq) {
+            std::cerr << "Error: KV cache of " << max_seq << " tokens is full." << std::endl;
+            return false;
+        }
+
+        // Attention sub-block.
+        for (uint32_t i = 0; i < d_model; i++) {
+            normed[i] = x[i];
+        }
+        apply_norm(normed.data(), x_moments, norm1_gamma.data(), norm1_beta.data());
+
+        const T* bqkv = b_qkv.data();
+        qkv->forward(normed.data(), qkv_out.data(), [bqkv](uint32_t r, T v) { return v + bqkv[r]; });
+
+        T* k_row = &k_cache[static_cast<size_t>(position) * d_model];
+        T* v_row = &v_cache[static_cast<size_t>(position) * d_model];
+        for (uint32_t i = 0; i < d_model; i++) {
+            k_row[i] = qkv_out[d_model + i];
+            v_row[i] = qkv_out[2 * d_model + i];
+        }
+        position++;
+
+        attend(qkv_out.data());
+
+        // Residual add and the moments of the FFN norm are fused into the O projection.
+        AnalogMoments<T> moments;
+        const T* bo = b_o.data();
+        proj_o->forward(attn.data(), resid.data(), [x, bo, &moments](uint32_t r, T v) {
+            T y = x[r] + v + bo[r];
+            moments.add(y);
+            return y;
+        });
+
+        // FFN sub-block.
+        for (uint32_t i = 0; i < d_model; i++) {
+            normed[i] = resid[i];
+        }
+        apply_norm(normed.data(), moments, norm2_gamma.data(), norm2_beta.data());
+
+        const T* b1 = b_1.data();
+        const AnalogLUT<T> &lut = tanh_lut;
+        ffn_up->forward(normed.data(), ff.data(), [b1, &lut](uint32_t r, T v) { return analog_gelu(v + b1[r], lut); });
+
+        const T* b2 = b_2.data();
+        const T* res = resid.data();
+        AnalogMoments<T> &out = out_moments;
+        out = AnalogMoments<T>();
+        ffn_down->forward(ff.data(), x, [b2, res, &out](uint32_t r, T v) {
+            T y = res[r] + v + b2[r];
+            out.add(y);
+            return y;
+        });
+        return true;
+    }
+
+    /**
+     * @brief Returns the moments of the last block output, gathered in the FFN down epilogue.
+     */
+    const AnalogMoments<T>& get_output_moments() const {
+        return out_moments;
+    }
+
+    /**
+     * @brief Clears the KV cache.
+     */
+    void reset() {
+        position = 0;
+    }
+
+    uint32_t get_position() const {
+        return position;
+    }
+
+private:
+    /**
+     * @brief Multi-head attention of query q against the cached keys and values, into attn.
+     */
+    void attend(const T* q) {
+        // Scores and context run on the host kernels: the K/V cache changes every token, so
+        // programming it on tiles would cost a full mvm_set_matrix per step (see suggest_placement).
+        T inv_sqrt = static_cast<T>(1.0 / std::sqrt(static_cast<double>(head_dim)));
+        for (uint32_t h = 0; h < n_heads; h++) {
+            const T* q_h = q + h * head_dim;
+            const T* k_h = &k_cache[h * head_dim];
+            T max = -std::numeric_limits<T>::infinity();
+            for (uint32_t t = 0; t < position; t++) {
+                scores[t] = analog_dot(q_h, k_h + static_cast<size_t>(t) * d_model, head_dim) * inv_sqrt;
+                max = scores[t] > max ? scores[t] : max;
+            }
+            analog_softmax_apply(scores.data(), position, max);
+            analog_weighted_rows(&v_cache[h * head_dim], d_model, scores.data(), position, &attn[h * head_dim],
+                                 head_dim);
+        }
+    }
+
+    void apply_norm(T* v, const AnalogMoments<T> &m, const T* gamma, const T* beta) {
+        if (norm == AnalogNorm::RMSNORM) {
+            analog_rmsnorm_apply(v, d_model, m, gamma);
+        } else {
+            analog_layernorm_apply(v, d_model, m, gamma, beta);
+        }
+    }
+
+    static void copy_param(T* dst, const T* src, uint32_t n) {
+        if (src) {
+            for (uint32_t i = 0; i < n; i++) {
+                dst[i] = src[i];
+            }
+        }
+    }
+
+    static std::vector<T> make_param(const T* src, uint32_t n, int fill) {
+        std::vector<T> p(n, static_cast<T>(fill));
+        copy_param(p.data(), src, n);
+        return p;
+    }
+
+    uint32_t d_model;    ///< Model width.
+    uint32_t n_heads;    ///< Number of attention heads.
+    uint32_t head_dim;   ///< Width of one head.
+    uint32_t d_ff;       ///< FFN hidden width.
+    uint32_t max_seq;    ///< KV cache capacity.
+    uint32_t position;   ///< Number of cached tokens.
+    AnalogNorm norm;     ///< Normalization type.
+
+    std::unique_ptr<AnalogTiledLinear<T, qT, oT>> qkv;      ///< Fused Q/K/V projection.
+    std::unique_ptr<AnalogTiledLinear<T, qT, oT>> proj_o;   ///< Output projection.
+    std::unique_ptr<AnalogTiledLinear<T, qT, oT>> ffn_up;   ///< FFN up projection.
+    std::unique_ptr<AnalogTiledLinear<T, qT, oT>> ffn_down; ///< FFN down projection.
+
+    std::vector<T> b_qkv, b_o, b_1, b_2;                    ///< Biases.
+    std::vector<T> norm1_gamma, norm1_beta;                 ///< Attention norm parameters.
+    std::vector<T> norm2_gamma, norm2_beta;                 ///< FFN norm parameters.
+    std::vector<T> k_cache, v_cache;                        ///< KV cache (max_seq x d_model).
+    std::vector<T> normed, qkv_out, attn, resid, ff, scores; ///< Per-token scratch.
+    AnalogMoments<T> out_moments;                           ///< Moments of the last block output.
+    AnalogLUT<T> tanh_lut;                                  ///< Table used by GELU.
+};
+
+#endif // ANALOG_TRANSFORMER_H
@@ -10,6 +10,10 @@ public:
         scale_factor *= scale;
     }
 
+    void set_scale_factor(double scale) {
+        scale_factor = scale;
+    }
+
     double get_scale_factor() {
         return scale_factor;
     }
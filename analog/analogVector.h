@@ -12,10 +12,20 @@
 #include <iomanip>
 #include <limits>
 #include <type_traits>
+#include <vector>
 #include <exception>  // For std::bad_alloc
 
 #include "analogType.h"
 
+/**
+ * @brief How an AnalogVector maps host values onto device codes.
+ */
+enum class AnalogInputEncoding {
+    SIGNED,   ///< Symmetric absmax quantization to [-qmax, qmax].
+    UNSIGNED, ///< Non-negative values mapped to [0, 2 qmax + 1] and stored offset by -(qmax + 1); negatives clamp to 0.
+    AUTO      ///< UNSIGNED when the vector has no negative element (e.g. after ReLU), SIGNED otherwise.
+};
+
 /**
  * @class AnalogVector
  * @brief Represents a vector compatible with MVM analog intrinsic calls.
@@ -32,8 +42,13 @@ public:
         : host_arr(nullptr),
           host_length(length),
           device_arr(nullptr),
-          device_length(DEVICE_COLS),
-          owns_host_arr(true) {
+          device_length(DEVICE_ROWS > DEVICE_COLS ? DEVICE_ROWS : DEVICE_COLS),
+          owns_host_arr(true),
+          outlier_threshold(0.0),
+          input_encoding(AnalogInputEncoding::SIGNED),
+          input_offset(0),
+          zero_threshold(0.0),
+          zero(false) {
         static_assert(std::is_arithmetic<T>::value, "AnalogVector requires arithmetic data type");
 
         // Allocate memory for host_arr
@@ -46,7 +61,7 @@ public:
 
         // Allocate memory for device_arr
         try {
-            device_arr = new T[device_length]();
+            device_arr = new qT[device_length]();
         } catch (const std::bad_alloc& e) {
             std::cerr << "Memory allocation failed for device_arr: " << e.what() << std::endl;
             delete[] host_arr;  // Free previously allocated memory before exiting
@@ -63,8 +78,13 @@ public:
         : host_arr(arr),
           host_length(length),
           device_arr(nullptr),
-          device_length(DEVICE_COLS),
-          owns_host_arr(false) {
+          device_length(DEVICE_ROWS > DEVICE_COLS ? DEVICE_ROWS : DEVICE_COLS),
+          owns_host_arr(false),
+          outlier_threshold(0.0),
+          input_encoding(AnalogInputEncoding::SIGNED),
+          input_offset(0),
+          zero_threshold(0.0),
+          zero(false) {
         static_assert(std::is_arithmetic<T>::value, "AnalogVector requires arithmetic data type");
 
         // Allocate memory for device_arr
@@ -100,8 +120,13 @@ public:
         }
 
         // Perform direct copy
+        input_offset = 0;
+        zero = true;
         for (uint32_t i = 0; i < host_length; i++) {
             device_arr[i] = host_arr[i];
+            if (std::abs(static_cast<double>(host_arr[i])) > zero_threshold) {
+                zero = false;
+            }
         }
     }
 
@@ -134,35 +159,58 @@ public:
             return;
         }
 
-        // Identify the scaling factor
+        // Identify the scaling factor, setting aside outliers so they do not inflate it
         double max_abs_value = 0.0f;
+        bool has_negative = false;
+        outliers.clear();
         for (uint32_t i = 0; i < host_length; i++) {
             double tmp_val = std::abs(host_arr[i]);
+            if (outlier_threshold > 0.0 && tmp_val > outlier_threshold) {
+                outliers.push_back(i);
+                continue;
+            }
+            if (host_arr[i] < 0) {
+                has_negative = true;
+            }
             if (tmp_val > max_abs_value) {
                 max_abs_value = tmp_val;
             }
         }
         scale_factor = (max_abs_value == 0.0f) ? 1.0f : max_abs_value;
+        zero = max_abs_value <= zero_threshold;
 
         // Determine quantization limits
         qT max_type_limit = std::numeric_limits<qT>::max();
         qT min_type_limit = std::numeric_limits<qT>::min();
 
+        // Non-negative vectors use the whole code range: u in [0, 2 qmax + 1], stored as u - (qmax + 1)
+        bool use_unsigned = input_encoding == AnalogInputEncoding::UNSIGNED ||
+                            (input_encoding == AnalogInputEncoding::AUTO && !has_negative);
+        input_offset = use_unsigned ? static_cast<int64_t>(max_type_limit) + 1 : 0;
+        double levels = use_unsigned ? 2.0 * max_type_limit + 1.0 : static_cast<double>(max_type_limit);
+        double lower_limit = use_unsigned ? 0.0 : static_cast<double>(min_type_limit);
+
+        size_t next_outlier = 0;
         for (uint32_t i = 0; i < host_length; i++) {
-            double scaled_value = static_cast<double>(host_arr[i] / scale_factor * max_type_limit);
+            if (next_outlier < outliers.size() && outliers[next_outlier] == i) {
+                device_arr[i] = static_cast<qT>(-input_offset); // Computed digitally by the caller
+                next_outlier++;
+                continue;
+            }
+            double scaled_value = static_cast<double>(host_arr[i] / scale_factor * levels);
 
             // Clamp the scaled value to the range of quant_type
-            if (scaled_value > static_cast<double>(max_type_limit)) {
-                scaled_value = static_cast<double>(max_type_limit);
+            if (scaled_value > levels) {
+                scaled_value = levels;
             }
-            else if (scaled_value < static_cast<double>(min_type_limit)) {
-                scaled_value = static_cast<double>(min_type_limit);
+            else if (scaled_value < lower_limit) {
+                scaled_value = lower_limit;
             }
 
-            device_arr[i] = static_cast<qT>(std::llround(scaled_value));
+            device_arr[i] = static_cast<qT>(std::llround(scaled_value) - input_offset);
         }
 
-        scale_factor /= std::numeric_limits<qT>::max();
+        scale_factor /= levels;
     }
 
     void transfer_to_device() {
@@ -194,6 +242,161 @@ public:
         }
     }
 
+    /**
+     * @brief Transfers data from the device array to the host array, applying an elementwise operation.
+     *
+     * Fuses a digital post-processing step (bias, activation, ...) into the dequantization pass
+     * so the result is written to the host array exactly once.
+     * @param scale The output scale used for dequantization.
+     * @param op Callable invoked as op(index, value) for each element; its result is stored in the host array.
+     */
+    template <typename Op>
+    void transfer_to_host(double scale, Op op) {
+        scale_factor = scale;
+        if (std::is_same<T, qT>::value) {
+            for (uint32_t i = 0; i < host_length; i++) {
+                host_arr[i] = op(i, static_cast<T>(device_arr[i]));
+            }
+        } else {
+            for (uint32_t i = 0; i < host_length; i++) {
+                host_arr[i] = op(i, static_cast<T>(static_cast<T>(device_arr[i]) * scale_factor));
+            }
+        }
+    }
+
+    /**
+     * @brief Enables outlier decomposition during quantization.
+     *
+     * Elements whose magnitude exceeds the threshold are excluded from the absmax scale and
+     * zeroed in the device array; their indices are available from get_outliers() so the
+     * caller can compute their contribution digitally in host precision.
+     * @param threshold Magnitude above which an element is an outlier; 0 disables the decomposition.
+     */
+    void set_outlier_threshold(double threshold) {
+        outlier_threshold = threshold;
+        outliers.clear();
+    }
+
+    /**
+     * @brief Sets the magnitude at or below which the whole vector counts as zero.
+     *
+     * The check rides on the absmax scan of the quantization, so it is free. With the default
+     * of 0 only exact zeros qualify, and skipping such a vector loses no accuracy.
+     * @param threshold Largest magnitude treated as zero.
+     */
+    void set_zero_threshold(double threshold) {
+        zero_threshold = threshold;
+    }
+
+    /**
+     * @brief Returns whether every (non-outlier) element was at or below the zero threshold in the last transfer.
+     *
+     * Callers may skip the load/compute/store of such a vector and treat its product as zero.
+     */
+    bool is_zero() const {
+        return zero;
+    }
+
+    /**
+     * @brief Resizes the device array, e.g. to the host length for the digital backend.
+     *
+     * Tiles read max(DEVICE_ROWS, DEVICE_COLS) elements; host-only consumers may use any length
+     * that holds the host array. The codes are cleared.
+     * @param length Number of device elements (>= host length).
+     */
+    void set_device_length(uint32_t length) {
+        if (length < host_length) {
+            std::cerr << "Error: a device array of " << length << " cannot hold " << host_length
+                      << " host elements." << std::endl;
+            return;
+        }
+        if (length == device_length) {
+            return;
+        }
+        delete[] device_arr;
+        device_length = length;
+        try {
+            device_arr = new qT[device_length]();
+        } catch (const std::bad_alloc&) {
+            std::cerr << "Memory allocation failed for device_arr" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /**
+     * @brief Declares the device array as symmetric codes written directly by the caller.
+     *
+     * Producers whose values have a known bound (e.g. tanh outputs) can write codes with a fixed
+     * scale, skipping the host array and the absmax scan; load the vector with
+     * mvm_load_device_vector.
+     * @param scale Host value of one code step.
+     */
+    void set_device_scale(double scale) {
+        scale_factor = scale;
+        input_offset = 0;
+        outliers.clear();
+        zero = true;
+        for (uint32_t i = 0; i < host_length; i++) {
+            if (device_arr[i] != 0) {
+                zero = false;
+                break;
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the indices (ascending) of the outliers found by the last quantization.
+     */
+    const std::vector<uint32_t>& get_outliers() const {
+        return outliers;
+    }
+
+    /**
+     * @brief Selects how the vector is quantized on the next transfer to the device.
+     *
+     * The unsigned encoding doubles the resolution of non-negative inputs (post-ReLU
+     * activations). Its codes are stored offset by -(qmax + 1) so they fit qT; the loads record
+     * the offset in the AnalogContext and the store adds offset * row_sum back per output row.
+     * @param encoding The encoding to use.
+     */
+    void set_input_encoding(AnalogInputEncoding encoding) {
+        input_encoding = encoding;
+    }
+
+    AnalogInputEncoding get_input_encoding() const {
+        return input_encoding;
+    }
+
+    /**
+     * @brief Returns the code offset applied by the last quantization (0 for the signed encoding).
+     */
+    int64_t get_input_offset() const {
+        return input_offset;
+    }
+
+    /**
+     * @brief Returns the host array.
+     * @return Pointer to the host array.
+     */
+    T* get_host_arr() const {
+        return host_arr;
+    }
+
+    /**
+     * @brief Returns the length of the host array.
+     * @return Length of the host array.
+     */
+    uint32_t get_host_length() const {
+        return host_length;
+    }
+
+    /**
+     * @brief Returns the length of the device array.
+     */
+    uint32_t get_device_length() const {
+        return device_length;
+    }
+
     /**
      * @brief Returns the device array.
      * @return Pointer to the device array.
@@ -255,6 +458,15 @@ private:
     uint32_t device_length; ///< Length of the device array.
                             
     bool owns_host_arr;     ///< Whether this object owns and should delete the host array.
+
+    double outlier_threshold;       ///< Magnitude above which elements bypass quantization (0 = off).
+    std::vector<uint32_t> outliers; ///< Indices of the outliers found by the last quantization.
+
+    AnalogInputEncoding input_encoding; ///< Requested quantization encoding.
+    int64_t input_offset;               ///< Offset subtracted from the codes by the last quantization.
+
+    double zero_threshold;  ///< Largest magnitude treated as zero by is_zero().
+    bool zero;              ///< Whether the last transferred vector was all zero.
 };
 
 #endif // ANALOG_VECTOR_H
@@ -0,0 +1,129 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include <future>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../analog/analog.h"
+
+int main(int argc, char** argv) {
+    // Usage: batching_example [requests per rate] [slo in ms]
+    uint32_t requests = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 2000;
+    double slo = (argc > 2 ? atof(argv[2]) : 5.0) / 1000.0;
+    const uint32_t rows = 64;
+    const uint32_t cols = 64;
+
+    std::mt19937 rng(42);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    std::vector<float> weights(rows * cols);
+    for (auto &w : weights) {
+        w = dist(rng);
+    }
+    std::vector<float> x(cols);
+    for (auto &v : x) {
+        v = dist(rng);
+    }
+
+    uint32_t num_tiles = AnalogTiledLinear<float, int8_t, int32_t>::count_tiles(rows, cols);
+    AnalogContext ctx(num_tiles);
+    AnalogTiledLinear<float, int8_t, int32_t> layer(ctx, weights.data(), rows, cols, 0);
+
+    // A weight-stationary batch must give the same results as one forward per vector
+    const uint32_t check = 16;
+    std::vector<float> xs_data(static_cast<size_t>(check) * cols), ys_data(static_cast<size_t>(check) * rows);
+    std::vector<float*> xs(check), ys(check);
+    for (uint32_t v = 0; v < check; v++) {
+        xs[v] = xs_data.data() + static_cast<size_t>(v) * cols;
+        ys[v] = ys_data.data() + static_cast<size_t>(v) * rows;
+        for (uint32_t j = 0; j < cols; j++) {
+            xs[v][j] = dist(rng);
+        }
+    }
+    layer.forward_batch(xs.data(), ys.data(), check);
+    std::vector<float> y(rows);
+    double batch_diff = 0.0;
+    for (uint32_t v = 0; v < check; v++) {
+        layer.forward(xs[v], y.data());
+        for (uint32_t i = 0; i < rows; i++) {
+            batch_diff = std::max(batch_diff, static_cast<double>(std::fabs(y[i] - ys[v][i])));
+        }
+    }
+    printf("forward_batch vs forward: max difference %g\n", batch_diff);
+    if (batch_diff != 0.0) {
+        return 1;
+    }
+
+    // Capacity of the layer when called directly
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < 200; i++) {
+        layer.forward(x.data(), y.data());
+    }
+    double service = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / 200;
+    printf("service time %.1f us (%.0f vectors/s), SLO %.1f ms\n", service * 1e6, 1.0 / service, slo * 1e3);
+    printf("%-6s %10s %10s %10s %10s %8s %10s %6s\n", "batch", "offered/s", "served/s", "p50 ms", "p99 ms", "size",
+           "window us", "util");
+
+    const double loads[] = {0.1, 0.3, 0.5, 0.7, 0.9, 1.1};
+    const uint32_t max_batches[] = {1, 16};
+    std::vector<float> out(static_cast<size_t>(requests) * rows);
+    for (uint32_t max_batch : max_batches) {
+        for (double load : loads) {
+            AnalogDynamicBatcher<float> batcher(max_batch, slo);
+            uint32_t target = batcher.add_target(layer);
+            batcher.start();
+
+            // Open-loop Poisson arrivals at the offered rate
+            double rate = load / service;
+            std::exponential_distribution<double> gap(rate);
+            std::vector<std::future<void>> done;
+            done.reserve(requests);
+            start = std::chrono::steady_clock::now();
+            auto next = start;
+            for (uint32_t i = 0; i < requests; i++) {
+                next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(gap(rng)));
+                std::this_thread::sleep_until(next);
+                done.push_back(batcher.submit(target, x.data(), out.data() + static_cast<size_t>(i) * rows));
+            }
+            for (auto &f : done) {
+                f.get();
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            printf("%-6u %10.0f %10.0f %10.3f %10.3f %8.2f %10.1f %6.2f\n", max_batch, rate, requests / seconds,
+                   batcher.get_latency_percentile(target, 50) * 1e3, batcher.get_latency_percentile(target, 99) * 1e3,
+                   batcher.get_mean_batch_size(target), batcher.get_window(target) * 1e6,
+                   batcher.get_utilization(target));
+            batcher.stop();
+        }
+    }
+
+    // Fairness: a second target must not wait behind the backlog of a saturated one
+    AnalogDynamicBatcher<float> batcher(16, slo);
+    uint32_t busy = batcher.add_target(layer);
+    uint32_t idle = batcher.add_target(layer);
+    batcher.start();
+    std::vector<std::future<void>> backlog;
+    for (uint32_t i = 0; i < requests; i++) {
+        backlog.push_back(batcher.submit(busy, x.data(), out.data() + static_cast<size_t>(i) * rows));
+    }
+    start = std::chrono::steady_clock::now();
+    batcher.submit(idle, x.data(), y.data()).get();
+    double wait = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint32_t queued = 0;
+    for (auto &f : backlog) {
+        if (f.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            queued++;
+        }
+    }
+    printf("second target served in %.3f ms with %u of %u backlog vectors still queued\n", wait * 1e3, queued,
+           requests);
+    for (auto &f : backlog) {
+        f.get();
+    }
+    batcher.stop();
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../analog/analog.h"
+
+// One worker process: alloc, program, pipelined mvm through the shared slots, then free or just exit
+static int worker(const char* path, uint32_t id, bool free_tiles) {
+    AnalogDaemonClient<float> client(path);
+    int32_t tile = client.alloc(1);
+    if (tile < 0) {
+        printf("worker %u: alloc failed\n", id);
+        return 1;
+    }
+
+    std::mt19937 rng(id);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    std::vector<float> weights(DEVICE_ROWS * DEVICE_COLS);
+    for (auto &w : weights) {
+        w = dist(rng);
+    }
+    if (!client.program(static_cast<uint16_t>(tile), weights.data(), DEVICE_ROWS, DEVICE_COLS)) {
+        printf("worker %u: program failed\n", id);
+        return 1;
+    }
+
+    // x and y live in the mapping received through SCM_RIGHTS; only the request crosses the socket
+    const uint32_t slots = client.get_num_slots();
+    double err = 0.0;
+    double norm = 0.0;
+    for (uint32_t it = 0; it < 50; it++) {
+        for (uint32_t s = 0; s < slots; s++) {
+            float* x = client.get_input(s);
+            for (uint32_t j = 0; j < DEVICE_COLS; j++) {
+                x[j] = dist(rng);
+            }
+            client.submit(static_cast<uint16_t>(tile), s);
+        }
+        for (uint32_t s = 0; s < slots; s++) {
+            if (client.complete() != 0) {
+                printf("worker %u: mvm failed\n", id);
+                return 1;
+            }
+            const float* x = client.get_input(s);
+            const float* y = client.get_output(s);
+            for (uint32_t i = 0; i < DEVICE_ROWS; i++) {
+                double ref = 0.0;
+                for (uint32_t j = 0; j < DEVICE_COLS; j++) {
+                    ref += static_cast<double>(weights[i * DEVICE_COLS + j]) * x[j];
+                }
+                err += (y[i] - ref) * (y[i] - ref);
+                norm += ref * ref;
+            }
+        }
+    }
+    double relerr = std::sqrt(err / norm);
+    printf("worker %u: tile %d, relative error %.4f, %s\n", id, tile, relerr,
+           free_tiles ? "frees its tile" : "exits holding its tile");
+    if (relerr > 0.05) {
+        return 1;
+    }
+    if (free_tiles && !client.free(static_cast<uint32_t>(tile), 1)) {
+        printf("worker %u: free failed\n", id);
+        return 1;
+    }
+    return 0;
+}
+
+int main() {
+    const char* path = "/tmp/analog-daemon-example.sock";
+    const uint32_t num_tiles = 8;
+    const uint32_t workers = 4;
+    AnalogContext ctx(num_tiles);
+    AnalogDaemon<float, int8_t, int32_t> daemon(ctx, path, 4);
+
+    // Fork before the daemon thread starts; the workers queue on the listening socket meanwhile
+    std::vector<pid_t> pids;
+    for (uint32_t w = 0; w < workers; w++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            int status = worker(path, w, w % 2 == 0);
+            fflush(stdout);
+            _exit(status);
+        }
+        pids.push_back(pid);
+    }
+    daemon.start();
+
+    int status = 0;
+    for (pid_t pid : pids) {
+        int ws = 0;
+        waitpid(pid, &ws, 0);
+        if (!WIFEXITED(ws) || WEXITSTATUS(ws) != 0) {
+            status = 1;
+        }
+    }
+
+    // Tiles of workers that exited without freeing are released when the daemon sees the disconnect
+    for (uint32_t i = 0; i < 100 && daemon.get_free_tiles() != num_tiles; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    printf("free tiles after the workers exited: %u of %u\n", daemon.get_free_tiles(), num_tiles);
+    if (daemon.get_free_tiles() != num_tiles) {
+        status = 1;
+    }
+
+    // A client cannot use a tile it does not own
+    AnalogDaemonClient<float> a(path);
+    AnalogDaemonClient<float> b(path);
+    int32_t tile = a.alloc(1);
+    std::vector<float> weights(DEVICE_ROWS * DEVICE_COLS, 1.0f);
+    bool foreign_program = b.program(static_cast<uint16_t>(tile), weights.data(), DEVICE_ROWS, DEVICE_COLS);
+    int32_t foreign_mvm = b.mvm(static_cast<uint16_t>(tile), 0);
+    printf("program / mvm on another client's tile: %s / %d\n", foreign_program ? "accepted" : "rejected", foreign_mvm);
+    if (foreign_program || foreign_mvm >= 0) {
+        status = 1;
+    }
+
+    daemon.stop();
+    printf("requests served: %llu\n", static_cast<unsigned long long>(daemon.get_requests()));
+    return status;
+}
@@ -0,0 +1,89 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "../analog/analog.h"
+
+#if defined(__AVX2__)
+static const char* kernel = "avx2";
+#elif defined(__riscv_v_intrinsic)
+static const char* kernel = "rvv";
+#else
+static const char* kernel = "scalar";
+#endif
+
+int main(int argc, char** argv) {
+    // Usage: digital_example [calls]
+    uint32_t calls = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 2000;
+    const uint16_t rows = 64;
+    const uint16_t cols = 256;
+
+    std::mt19937 rng(3);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    std::vector<float> weights(static_cast<size_t>(rows) * cols);
+    for (auto &w : weights) {
+        w = dist(rng);
+    }
+    std::vector<float> x(cols);
+    for (auto &v : x) {
+        v = dist(rng);
+    }
+
+    // A digital layer keeps host-sized buffers, so it is not limited to one tile
+    AnalogContext ctx(1);
+    AnalogLinear<float, int8_t, int32_t> layer(ctx, weights.data(), rows, cols, AnalogPlacement::DIGITAL);
+    std::vector<float> y(rows);
+    layer.forward(x.data(), y.data());
+
+    double err = 0.0;
+    double norm = 0.0;
+    for (uint32_t i = 0; i < rows; i++) {
+        double ref = 0.0;
+        for (uint32_t j = 0; j < cols; j++) {
+            ref += static_cast<double>(weights[static_cast<size_t>(i) * cols + j]) * x[j];
+        }
+        err += (y[i] - ref) * (y[i] - ref);
+        norm += ref * ref;
+    }
+    printf("%ux%u digital layer, %s kernel: relative error %.4f vs float\n", rows, cols, kernel,
+           std::sqrt(err / norm));
+
+    // The vectorized int8 kernel must match the generic scalar one exactly
+    AnalogMatrix<float, int8_t> &mat = layer.get_matrix();
+    AnalogVector<float, int8_t> in(x.data(), cols);
+    in.set_device_length(cols);
+    in.transfer_to_device();
+    const int8_t* codes = mat.get_device_mat();
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < rows; i++) {
+        const int8_t* row = codes + static_cast<size_t>(i) * mat.get_device_cols();
+        if (digital_dot(row, in.get_device_arr(), cols) != digital_dot<int8_t>(row, in.get_device_arr(), cols)) {
+            mismatches++;
+        }
+    }
+    printf("kernel rows differing from the scalar reference: %u\n", mismatches);
+    if (mismatches != 0) {
+        return 1;
+    }
+
+    std::vector<int32_t> out(rows);
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t c = 0; c < calls; c++) {
+        digital_gemv(codes, mat.get_device_cols(), in.get_device_arr(), out.data(), rows, cols);
+    }
+    double fast = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / calls;
+    volatile int64_t sink = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t c = 0; c < calls; c++) {
+        for (uint32_t i = 0; i < rows; i++) {
+            sink += digital_dot<int8_t>(codes + static_cast<size_t>(i) * mat.get_device_cols(), in.get_device_arr(),
+                                        cols);
+        }
+    }
+    double scalar = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / calls;
+    printf("gemv %.2f us (%s) vs %.2f us (scalar), %.1fx\n", fast * 1e6, kernel, scalar * 1e6, scalar / fast);
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../analog/analog.h"
+
+// Sequential read bandwidth of the file in MB/s (1 MiB preads)
+static double disk_bandwidth(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0.0;
+    }
+    std::vector<char> buf(1 << 20);
+    size_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+    ssize_t n;
+    while ((n = pread(fd, buf.data(), buf.size(), static_cast<off_t>(total))) > 0) {
+        total += static_cast<size_t>(n);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    close(fd);
+    return total / seconds / 1e6;
+}
+
+// Programs every block with a staging cache no larger than the read-ahead and compares the
+// programmed codes and scale against the record in the file; returns the number of mismatches
+static uint64_t verify_small_cache(const char* path, AnalogContext &ctx, AnalogThreadPool &io_pool,
+                                   uint32_t cache_blocks, uint32_t readahead) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return ~0ull;
+    }
+    AnalogBlockPager<float, int8_t> pager(path, io_pool, cache_blocks, readahead);
+    std::vector<uint8_t> record(pager.get_record_bytes());
+    uint64_t wrong = 0;
+    for (uint64_t b = 0; b < pager.get_num_blocks(); b++) {
+        uint16_t tile = static_cast<uint16_t>(b % ctx.get_num_arrays());
+        pager.program(ctx, b, tile);
+        off_t offset = static_cast<off_t>(sizeof(AnalogBlockFileHeader) + b * record.size());
+        if (pread(fd, record.data(), record.size(), offset) != static_cast<ssize_t>(record.size())) {
+            wrong++;
+            continue;
+        }
+        AnalogBlockRecordHeader rec;
+        std::memcpy(&rec, record.data(), sizeof(rec));
+        AnalogMatrix<float, int8_t> &mat = pager.get_matrix(tile);
+        if (rec.scale != mat.get_scale_factor() ||
+            std::memcmp(mat.get_device_mat(), record.data() + sizeof(rec), DEVICE_ROWS * DEVICE_COLS) != 0) {
+            wrong++;
+        }
+    }
+    close(fd);
+    return wrong;
+}
+
+int main(int argc, char** argv) {
+    // Usage: paging_example [block file] [rows] [cols]; put the file on NVMe or tmpfs
+    const char* path = argc > 1 ? argv[1] : "/tmp/analog_blocks.bin";
+    uint32_t rows = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 2048;
+    uint32_t cols = argc > 3 ? static_cast<uint32_t>(atoi(argv[3])) : 2048;
+    const uint32_t num_tiles = 8;
+
+    std::mt19937 rng(42);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    std::vector<float> weights(static_cast<size_t>(rows) * cols);
+    for (auto &w : weights) {
+        w = dist(rng);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t num_blocks;
+    {
+        AnalogBlockWriter<float, int8_t> writer(path);
+        writer.append_matrix(weights.data(), rows, cols);
+        num_blocks = writer.get_num_blocks();
+    }
+    double write_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    weights.clear();
+    weights.shrink_to_fit();
+
+    double bandwidth = disk_bandwidth(path);
+    printf("%llu blocks of %u bytes written in %.3f s; sequential read %.1f MB/s\n",
+           static_cast<unsigned long long>(num_blocks), analog_block_record_bytes<int8_t>(), write_s, bandwidth);
+
+    AnalogContext ctx(num_tiles);
+    AnalogThreadPool io_pool(4);
+    const uint32_t readaheads[] = {0, 4, 16, 64};
+    for (uint32_t readahead : readaheads) {
+        AnalogBlockPager<float, int8_t> pager(path, io_pool, readahead + 2, readahead);
+        start = std::chrono::steady_clock::now();
+        for (uint64_t b = 0; b < num_blocks; b++) {
+            pager.program(ctx, b, static_cast<uint16_t>(b % num_tiles));
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double mb_s = pager.get_bytes_read() / seconds / 1e6;
+        printf("readahead %3u: %10.0f tiles/s  %8.1f MB/s  (%5.1f%% of disk)  hits %llu waits %llu misses %llu\n",
+               readahead, num_blocks / seconds, mb_s, bandwidth > 0 ? 100.0 * mb_s / bandwidth : 0.0,
+               static_cast<unsigned long long>(pager.get_hits()), static_cast<unsigned long long>(pager.get_waits()),
+               static_cast<unsigned long long>(pager.get_misses()));
+    }
+
+    const uint32_t small_caches[][2] = {{1, 1}, {2, 4}, {5, 8}};
+    for (const auto &config : small_caches) {
+        uint64_t wrong = verify_small_cache(path, ctx, io_pool, config[0], config[1]);
+        printf("cache %u readahead %2u: %llu of %llu programmed blocks differ from the file\n", config[0], config[1],
+               static_cast<unsigned long long>(wrong), static_cast<unsigned long long>(num_blocks));
+        if (wrong != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
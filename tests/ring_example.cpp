@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../analog/analog.h"
+
+typedef std::chrono::steady_clock Clock;
+
+struct Result {
+    double throughput;  // Commands per second
+    double p50;         // Submit-to-completion latency (s)
+    double p99;
+};
+
+// Runs commands_per_producer closed-loop mvm commands on every producer thread
+template <typename Issue>
+static Result run(uint32_t producers, uint32_t commands_per_producer, Issue issue) {
+    std::vector<std::vector<double>> latencies(producers);
+    std::vector<std::thread> threads;
+    Clock::time_point start = Clock::now();
+    for (uint32_t p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            latencies[p].reserve(commands_per_producer);
+            for (uint32_t i = 0; i < commands_per_producer; i++) {
+                Clock::time_point t0 = Clock::now();
+                issue(p);
+                latencies[p].push_back(std::chrono::duration<double>(Clock::now() - t0).count());
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<double> all;
+    for (auto &l : latencies) {
+        all.insert(all.end(), l.begin(), l.end());
+    }
+    std::sort(all.begin(), all.end());
+    Result r;
+    r.throughput = all.size() / seconds;
+    r.p50 = all[all.size() / 2];
+    r.p99 = all[std::min(all.size() - 1, all.size() * 99 / 100)];
+    return r;
+}
+
+int main(int argc, char** argv) {
+    // Usage: ring_example [commands per producer] [tiles]
+    uint32_t commands = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : 2000;
+    uint32_t num_tiles = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 4;
+    const uint32_t max_producers = 64;
+
+    std::mt19937 rng(42);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    AnalogContext ctx(num_tiles);
+    std::vector<std::unique_ptr<AnalogMatrix<float, int8_t>>> mats;
+    for (uint32_t t = 0; t < num_tiles; t++) {
+        std::vector<float> w(DEVICE_ROWS * DEVICE_COLS);
+        for (auto &v : w) {
+            v = dist(rng);
+        }
+        mats.emplace_back(new AnalogMatrix<float, int8_t>(w.data(), DEVICE_ROWS, DEVICE_COLS));
+        mvm_set_matrix(ctx, *mats.back(), static_cast<uint16_t>(t));
+    }
+
+    // Private vectors of every producer
+    std::vector<std::vector<float>> xs(max_producers, std::vector<float>(DEVICE_COLS));
+    std::vector<std::vector<float>> ys(max_producers, std::vector<float>(DEVICE_ROWS));
+    std::vector<std::unique_ptr<AnalogVector<float, int8_t>>> ins;
+    std::vector<std::unique_ptr<AnalogVector<float, int32_t>>> outs;
+    for (uint32_t p = 0; p < max_producers; p++) {
+        for (auto &v : xs[p]) {
+            v = dist(rng);
+        }
+        ins.emplace_back(new AnalogVector<float, int8_t>(xs[p].data(), DEVICE_COLS));
+        outs.emplace_back(new AnalogVector<float, int32_t>(ys[p].data(), DEVICE_ROWS));
+    }
+
+    printf("%u commands per producer on %u shared tiles\n", commands, num_tiles);
+    printf("%-9s | %12s %10s %10s | %12s %10s %10s %7s\n", "producers", "mutex cmd/s", "p50 us", "p99 us",
+           "ring cmd/s", "p50 us", "p99 us", "batch");
+
+    const uint32_t producer_counts[] = {1, 2, 4, 8, 16, 32, 64};
+    for (uint32_t producers : producer_counts) {
+        // Baseline: every producer drives the device itself under a per-tile mutex
+        std::vector<std::mutex> tile_mutex(num_tiles);
+        Result base = run(producers, commands, [&](uint32_t p) {
+            uint16_t tile = static_cast<uint16_t>(p % num_tiles);
+            std::lock_guard<std::mutex> lock(tile_mutex[tile]);
+            mvm_load_vector(ctx, *ins[p], tile);
+            mvm_compute(ctx, tile);
+            mvm_store_vector(ctx, *outs[p], tile);
+        });
+
+        // Ring: producers enqueue descriptors, one owner thread drives the device
+        AnalogSubmitRing<float, int8_t, int32_t> ring(ctx, 1024, 64);
+        std::vector<AnalogMvmTicket> tickets(producers);
+        ring.start();
+        Result lockfree = run(producers, commands, [&](uint32_t p) {
+            ring.submit(*ins[p], *outs[p], static_cast<uint16_t>(p % num_tiles), tickets[p]);
+            ring.wait(tickets[p]);
+        });
+        ring.stop();
+
+        printf("%-9u | %12.0f %10.1f %10.1f | %12.0f %10.1f %10.1f %7.2f\n", producers, base.throughput,
+               base.p50 * 1e6, base.p99 * 1e6, lockfree.throughput, lockfree.p50 * 1e6, lockfree.p99 * 1e6,
+               ring.get_mean_batch());
+    }
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "../analog/analog.h"
+
+// CPU-only baseline: double-precision conjugate gradient
+static uint32_t cpu_cg(const std::vector<float> &a, const std::vector<float> &b, std::vector<float> &x,
+                       uint32_t n, uint32_t max_iter, double tol) {
+    std::vector<double> r(n), p(n), ap(n);
+    double b_norm = 0.0;
+    for (uint32_t i = 0; i < n; i++) {
+        b_norm += static_cast<double>(b[i]) * b[i];
+        r[i] = b[i];
+        p[i] = b[i];
+        x[i] = 0.0f;
+    }
+    b_norm = std::sqrt(b_norm);
+    double rr = b_norm * b_norm;
+    uint32_t k = 0;
+    for (; k < max_iter && std::sqrt(rr) / b_norm >= tol; k++) {
+        double pap = 0.0;
+        for (uint32_t i = 0; i < n; i++) {
+            double acc = 0.0;
+            for (uint32_t j = 0; j < n; j++) {
+                acc += a[i * n + j] * p[j];
+            }
+            ap[i] = acc;
+            pap += p[i] * acc;
+        }
+        double alpha = rr / pap;
+        double rr_new = 0.0;
+        for (uint32_t i = 0; i < n; i++) {
+            x[i] += static_cast<float>(alpha * p[i]);
+            r[i] -= alpha * ap[i];
+            rr_new += r[i] * r[i];
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            p[i] = r[i] + rr_new / rr * p[i];
+        }
+        rr = rr_new;
+    }
+    return k;
+}
+
+// Relative residual ||b - A x|| / ||b|| in double precision
+static double true_residual(const std::vector<float> &a, const std::vector<float> &b,
+                            const std::vector<float> &x, uint32_t n) {
+    double rr = 0.0, bb = 0.0;
+    for (uint32_t i = 0; i < n; i++) {
+        double acc = b[i];
+        for (uint32_t j = 0; j < n; j++) {
+            acc -= static_cast<double>(a[i * n + j]) * x[j];
+        }
+        rr += acc * acc;
+        bb += static_cast<double>(b[i]) * b[i];
+    }
+    return std::sqrt(rr / bb);
+}
+
+static void run(const char* name, std::vector<float> &a, uint32_t n) {
+    using input = int8_t;
+    using output = int32_t;
+    const double tol = 1e-6;
+
+    std::vector<float> b(n), x(n);
+    for (uint32_t i = 0; i < n; i++) {
+        b[i] = 1.0f + 0.01f * i;
+    }
+
+    AnalogContext ctx(AnalogSolver<float, input, output>::count_tiles(n));
+    AnalogSolver<float, input, output> solver(ctx, a.data(), n, 0);
+
+    auto t0 = std::chrono::steady_clock::now();
+    uint32_t cpu_iters = cpu_cg(a, b, x, n, 1000, tol);
+    auto t1 = std::chrono::steady_clock::now();
+    printf("%s n=%u\n", name, n);
+    printf("\tcpu cg:        %4u iterations, %8.3f ms\n", cpu_iters,
+           std::chrono::duration<double, std::milli>(t1 - t0).count());
+
+    const AnalogSolverMethod methods[] = {AnalogSolverMethod::JACOBI, AnalogSolverMethod::CONJUGATE_GRADIENT};
+    const char* labels[] = {"jacobi", "cg"};
+    for (int m = 0; m < 2; m++) {
+        for (uint32_t i = 0; i < n; i++) {
+            x[i] = 0.0f;
+        }
+        AnalogSolverStats plain = m == 0 ? solver.jacobi(b.data(), x.data(), 200, tol)
+                                         : solver.conjugate_gradient(b.data(), x.data(), 200, tol);
+        double plain_residual = true_residual(a, b, x, n);
+        for (uint32_t i = 0; i < n; i++) {
+            x[i] = 0.0f;
+        }
+        t0 = std::chrono::steady_clock::now();
+        AnalogSolverStats refined = solver.refine(b.data(), x.data(), methods[m], 10, 50, tol);
+        t1 = std::chrono::steady_clock::now();
+        printf("\tanalog %-6s  %4u iterations, true residual %.2e (limited by the quantized product)\n",
+               labels[m], plain.iterations, plain_residual);
+        printf("\trefined %-6s %4u outer, %4u matvecs, true residual %.2e, %s, %8.3f ms\n", labels[m],
+               refined.iterations, refined.matvecs, true_residual(a, b, x, n),
+               refined.converged ? "converged" : "not converged",
+               std::chrono::duration<double, std::milli>(t1 - t0).count());
+    }
+
+    std::vector<float> v(n, 1.0f);
+    float lambda = 0.0f;
+    AnalogSolverStats power = solver.power_iteration(v.data(), lambda, 500, 1e-5);
+    printf("\tpower iteration: lambda %.4f after %u iterations\n", lambda, power.iterations);
+}
+
+int main() {
+    const uint32_t n = 64;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    // Dense symmetric, diagonally dominant (SPD)
+    std::vector<float> dense(n * n);
+    for (uint32_t i = 0; i < n; i++) {
+        for (uint32_t j = 0; j < i; j++) {
+            dense[i * n + j] = dense[j * n + i] = dist(rng);
+        }
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        float sum = 0.0f;
+        for (uint32_t j = 0; j < n; j++) {
+            sum += std::fabs(dense[i * n + j]);
+        }
+        dense[i * n + i] = sum + 1.0f;
+    }
+    run("dense", dense, n);
+
+    // Sparse tridiagonal (shifted 1D Laplacian)
+    std::vector<float> sparse(n * n, 0.0f);
+    for (uint32_t i = 0; i < n; i++) {
+        sparse[i * n + i] = 4.0f;
+        if (i > 0) {
+            sparse[i * n + i - 1] = -1.0f;
+        }
+        if (i + 1 < n) {
+            sparse[i * n + i + 1] = -1.0f;
+        }
+    }
+    run("sparse", sparse, n);
+
+    return 0;
+}
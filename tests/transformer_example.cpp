@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+#include "../analog/analog.h"
+
+using Ref = std::vector<double>;
+
+// Host weights of one block, kept so the double reference can use them
+struct BlockWeights {
+    std::vector<float> wq, wk, wv, wo, w1, w2, bq, b1, b2, gamma1, beta1, gamma2, beta2;
+};
+
+static std::vector<float> random_vector(std::mt19937 &rng, size_t n, float offset, float range) {
+    std::uniform_real_distribution<float> dist(-range, range);
+    std::vector<float> v(n);
+    for (auto &x : v) {
+        x = offset + dist(rng);
+    }
+    return v;
+}
+
+static Ref matvec(const std::vector<float> &w, const Ref &x, uint32_t rows, uint32_t cols) {
+    Ref y(rows, 0.0);
+    for (uint32_t i = 0; i < rows; i++) {
+        for (uint32_t j = 0; j < cols; j++) {
+            y[i] += w[static_cast<size_t>(i) * cols + j] * x[j];
+        }
+    }
+    return y;
+}
+
+static Ref normalize(const Ref &x, const std::vector<float> &gamma, const std::vector<float> &beta, AnalogNorm norm) {
+    double mean = 0.0, sq = 0.0;
+    for (double v : x) {
+        mean += v;
+        sq += v * v;
+    }
+    mean /= x.size();
+    sq /= x.size();
+    Ref y(x.size());
+    for (size_t i = 0; i < x.size(); i++) {
+        if (norm == AnalogNorm::RMSNORM) {
+            y[i] = x[i] / std::sqrt(sq + 1e-6) * gamma[i];
+        } else {
+            y[i] = (x[i] - mean) / std::sqrt(sq - mean * mean + 1e-5) * gamma[i] + beta[i];
+        }
+    }
+    return y;
+}
+
+// Double-precision decode of one token through one block, with its own KV cache
+static Ref reference_decode(const BlockWeights &w, const Ref &x, std::vector<Ref> &keys, std::vector<Ref> &values,
+                            uint32_t d_model, uint32_t n_heads, uint32_t d_ff, AnalogNorm norm) {
+    Ref h = normalize(x, w.gamma1, w.beta1, norm);
+    Ref q = matvec(w.wq, h, d_model, d_model);
+    for (uint32_t i = 0; i < d_model; i++) {
+        q[i] += w.bq[i];
+    }
+    keys.push_back(matvec(w.wk, h, d_model, d_model));
+    values.push_back(matvec(w.wv, h, d_model, d_model));
+
+    uint32_t head_dim = d_model / n_heads;
+    Ref attn(d_model, 0.0);
+    for (uint32_t hd = 0; hd < n_heads; hd++) {
+        Ref scores(keys.size());
+        double max = -1e300, sum = 0.0;
+        for (size_t t = 0; t < keys.size(); t++) {
+            double s = 0.0;
+            for (uint32_t j = 0; j < head_dim; j++) {
+                s += q[hd * head_dim + j] * keys[t][hd * head_dim + j];
+            }
+            scores[t] = s / std::sqrt(static_cast<double>(head_dim));
+            max = std::max(max, scores[t]);
+        }
+        for (auto &s : scores) {
+            s = std::exp(s - max);
+            sum += s;
+        }
+        for (size_t t = 0; t < keys.size(); t++) {
+            for (uint32_t j = 0; j < head_dim; j++) {
+                attn[hd * head_dim + j] += scores[t] / sum * values[t][hd * head_dim + j];
+            }
+        }
+    }
+
+    Ref o = matvec(w.wo, attn, d_model, d_model);
+    Ref resid(d_model);
+    for (uint32_t i = 0; i < d_model; i++) {
+        resid[i] = x[i] + o[i];
+    }
+    Ref ff = matvec(w.w1, normalize(resid, w.gamma2, w.beta2, norm), d_ff, d_model);
+    for (uint32_t i = 0; i < d_ff; i++) {
+        double z = ff[i] + w.b1[i];
+        ff[i] = 0.5 * z * (1.0 + std::tanh(0.7978845608028654 * (z + 0.044715 * z * z * z)));
+    }
+    Ref down = matvec(w.w2, ff, d_model, d_ff);
+    Ref y(d_model);
+    for (uint32_t i = 0; i < d_model; i++) {
+        y[i] = resid[i] + down[i] + w.b2[i];
+    }
+    return y;
+}
+
+int main() {
+    const uint32_t d_model = 24;
+    const uint32_t n_heads = 4;
+    const uint32_t d_ff = 48;
+    const uint32_t seq = 6;
+    const uint32_t layers = 2;
+    typedef AnalogTransformerBlock<float, int8_t, int32_t> Block;
+
+    std::mt19937 rng(7);
+    std::vector<BlockWeights> weights(layers);
+    for (auto &w : weights) {
+        float range = 1.0f / std::sqrt(static_cast<float>(d_model));
+        w.wq = random_vector(rng, d_model * d_model, 0.0f, range);
+        w.wk = random_vector(rng, d_model * d_model, 0.0f, range);
+        w.wv = random_vector(rng, d_model * d_model, 0.0f, range);
+        w.wo = random_vector(rng, d_model * d_model, 0.0f, range);
+        w.w1 = random_vector(rng, d_ff * d_model, 0.0f, range);
+        w.w2 = random_vector(rng, d_model * d_ff, 0.0f, 1.0f / std::sqrt(static_cast<float>(d_ff)));
+        w.bq = random_vector(rng, d_model, 0.0f, 0.1f);
+        w.b1 = random_vector(rng, d_ff, 0.0f, 0.1f);
+        w.b2 = random_vector(rng, d_model, 0.0f, 0.1f);
+        w.gamma1 = random_vector(rng, d_model, 1.0f, 0.2f);
+        w.beta1 = random_vector(rng, d_model, 0.0f, 0.1f);
+        w.gamma2 = random_vector(rng, d_model, 1.0f, 0.2f);
+        w.beta2 = random_vector(rng, d_model, 0.0f, 0.1f);
+    }
+    std::vector<std::vector<float>> tokens(seq);
+    for (auto &x : tokens) {
+        x = random_vector(rng, d_model, 0.0f, 1.0f);
+    }
+
+    uint32_t tiles_per_block = Block::tiles_required(d_model, d_ff);
+    AnalogContext ctx(layers * tiles_per_block);
+    printf("%u blocks of %u tiles, d_model %u, d_ff %u, %u heads, %u tokens\n",
+           layers, tiles_per_block, d_model, d_ff, n_heads, seq);
+
+    const AnalogNorm norms[2] = {AnalogNorm::LAYERNORM, AnalogNorm::RMSNORM};
+    const char* names[2] = {"LayerNorm", "RMSNorm"};
+    int status = 0;
+    for (uint32_t n = 0; n < 2; n++) {
+        std::vector<std::unique_ptr<Block>> blocks;
+        for (uint32_t l = 0; l < layers; l++) {
+            AnalogTransformerWeights<float> w;
+            w.wq = weights[l].wq.data();
+            w.wk = weights[l].wk.data();
+            w.wv = weights[l].wv.data();
+            w.wo = weights[l].wo.data();
+            w.w1 = weights[l].w1.data();
+            w.w2 = weights[l].w2.data();
+            w.bq = weights[l].bq.data();
+            w.b1 = weights[l].b1.data();
+            w.b2 = weights[l].b2.data();
+            w.norm1_gamma = weights[l].gamma1.data();
+            w.norm1_beta = weights[l].beta1.data();
+            w.norm2_gamma = weights[l].gamma2.data();
+            w.norm2_beta = weights[l].beta2.data();
+            blocks.emplace_back(new Block(ctx, w, d_model, n_heads, d_ff, seq,
+                                          static_cast<uint16_t>(l * tiles_per_block), norms[n]));
+        }
+
+        std::vector<std::vector<Ref>> keys(layers), values(layers);
+        double err = 0.0, ref_norm = 0.0;
+        for (uint32_t t = 0; t < seq; t++) {
+            std::vector<float> x = tokens[t];
+            Ref ref(x.begin(), x.end());
+            // The first block measures its input; later blocks reuse the moments the previous
+            // block gathered in its FFN epilogue.
+            blocks[0]->decode(x.data());
+            for (uint32_t l = 1; l < layers; l++) {
+                blocks[l]->decode(x.data(), blocks[l - 1]->get_output_moments());
+            }
+            for (uint32_t l = 0; l < layers; l++) {
+                ref = reference_decode(weights[l], ref, keys[l], values[l], d_model, n_heads, d_ff, norms[n]);
+            }
+            for (uint32_t i = 0; i < d_model; i++) {
+                err += (x[i] - ref[i]) * (x[i] - ref[i]);
+                ref_norm += ref[i] * ref[i];
+            }
+        }
+        double relerr = std::sqrt(err / ref_norm);
+        printf("%s: relative error %.4f vs double reference\n", names[n], relerr);
+        if (relerr > 0.02) {
+            status = 1;
+        }
+    }
+    return status;
+}